@@ -0,0 +1,116 @@
+//==============================================================================
+// Copyright (C) John-Philip Taylor
+// jpt13653903@gmail.com
+//
+// This file is part of a library
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//==============================================================================
+
+#include "Arena.h"
+//------------------------------------------------------------------------------
+
+// Blocks double in size up to this limit, which keeps the block count
+// logarithmic for small documents and linear with a large stride for big ones
+#define MaxBlockSize (16*MiB)
+//------------------------------------------------------------------------------
+
+ARENA::ARENA(size_t BlockSize){
+  Blocks          = 0;
+  this->BlockSize = BlockSize;
+}
+//------------------------------------------------------------------------------
+
+ARENA::~ARENA(){
+  while(Blocks){
+    BLOCK* Next = Blocks->Next;
+    free(Blocks);
+    Blocks = Next;
+  }
+}
+//------------------------------------------------------------------------------
+
+void* ARENA::NewBlock(size_t Size, size_t Align){
+  size_t Header = (sizeof(BLOCK) + Align - 1) & ~(Align - 1);
+
+  if(Size + Header > BlockSize){
+    // Oversized requests get a block of their own
+    BLOCK* Block = (BLOCK*)malloc(Header + Size);
+    if(!Block) throw std::bad_alloc();
+    Block->Size = Header + Size - sizeof(BLOCK);
+    Block->Used = Block->Size;
+
+    // Keep the current block at the head, so that its free space is not lost
+    if(Blocks){
+      Block ->Next = Blocks->Next;
+      Blocks->Next = Block;
+    }else{
+      Block ->Next = 0;
+      Blocks       = Block;
+    }
+    return (char*)Block + Header;
+  }
+
+  BLOCK* Block = (BLOCK*)malloc(BlockSize);
+  if(!Block) throw std::bad_alloc();
+  Block->Next = Blocks;
+  Block->Size = BlockSize - sizeof(BLOCK);
+  Block->Used = Header - sizeof(BLOCK) + Size;
+  Blocks      = Block;
+
+  if(BlockSize < MaxBlockSize) BlockSize *= 2;
+
+  return (char*)Block + Header;
+}
+//------------------------------------------------------------------------------
+
+void* ARENA::Allocate(size_t Size, size_t Align){
+  if(Blocks){
+    uintptr_t Base  = (uintptr_t)(Blocks + 1);
+    uintptr_t Start = (Base + Blocks->Used + Align - 1) & ~(uintptr_t)(Align - 1);
+    if(Start + Size <= Base + Blocks->Size){
+      Blocks->Used = Start + Size - Base;
+      return (void*)Start;
+    }
+  }
+  return NewBlock(Size, Align);
+}
+//------------------------------------------------------------------------------
+
+char* ARENA::Duplicate(const char* Data, size_t Length){
+  char* Result = (char*)Allocate(Length + 1, 1);
+  memcpy(Result, Data, Length);
+  Result[Length] = 0;
+  return Result;
+}
+//------------------------------------------------------------------------------
+
+void ARENA::Clear(){
+  if(!Blocks) return;
+
+  while(Blocks->Next){
+    BLOCK* Next = Blocks->Next->Next;
+    free(Blocks->Next);
+    Blocks->Next = Next;
+  }
+  Blocks->Used = 0;
+}
+//------------------------------------------------------------------------------
+
+unsigned ARENA::GetBlockCount(){
+  unsigned Count = 0;
+  for(BLOCK* Block = Blocks; Block; Block = Block->Next) Count++;
+  return Count;
+}
+//------------------------------------------------------------------------------
+
+size_t ARENA::GetSize(){
+  size_t Size = 0;
+  for(BLOCK* Block = Blocks; Block; Block = Block->Next){
+    Size += sizeof(BLOCK) + Block->Size;
+  }
+  return Size;
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,105 @@
+//==============================================================================
+// Copyright (C) John-Philip Taylor
+// jpt13653903@gmail.com
+//
+// This file is part of a library
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//==============================================================================
+
+// A bump allocator: memory is handed out sequentially from large blocks and
+// is only ever released all at once, by Clear() or the destructor.  Objects
+// placed in the arena are never freed individually, so anything that needs a
+// destructor to release other resources must not be put in an arena.
+//------------------------------------------------------------------------------
+
+#ifndef Arena_h
+#define Arena_h
+//------------------------------------------------------------------------------
+
+#include <new>
+#include <type_traits>
+//------------------------------------------------------------------------------
+
+#include "General.h"
+//------------------------------------------------------------------------------
+
+class ARENA{
+  private:
+    struct BLOCK{
+      BLOCK* Next; // Older block
+      size_t Size; // Usable bytes following the header
+      size_t Used;
+    };
+    BLOCK* Blocks;    // Most recent block first
+    size_t BlockSize; // Size of the next block to be requested
+
+    void* NewBlock(size_t Size, size_t Align);
+
+  public:
+    ARENA(size_t BlockSize = 64*kiB);
+   ~ARENA();
+    ARENA(const ARENA&) = delete;
+    ARENA& operator= (const ARENA&) = delete;
+
+    // Returns uninitialised memory, aligned to "Align" (a power of 2)
+    void* Allocate(size_t Size, size_t Align = sizeof(void*));
+
+    // Returns a null-terminated copy of the first "Length" bytes of "Data"
+    char* Duplicate(const char* Data, size_t Length);
+
+    // Releases everything allocated so far.  The most recent block is kept
+    // for reuse, so that repeatedly filling and clearing the same arena
+    // does not go back to the system every time.
+    void Clear();
+
+    unsigned GetBlockCount(); // Number of blocks obtained from the system
+    size_t   GetSize      (); // Total bytes obtained from the system
+};
+//------------------------------------------------------------------------------
+
+// Standard-library compatible allocator.  With a null arena it falls back to
+// the global heap, so that the same container type can be used in both modes.
+// Copies keep the allocator of the destination, so that values copied into an
+// arena stay in the arena.  Move-assigning a freshly constructed container is
+// the way to change the arena a container is bound to.
+template<class type> class ARENA_ALLOCATOR{
+  public:
+    typedef type value_type;
+
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+
+    ARENA* Arena;
+
+    ARENA_ALLOCATOR(ARENA* Arena = 0){
+      this->Arena = Arena;
+    }
+    template<class other> ARENA_ALLOCATOR(const ARENA_ALLOCATOR<other>& Allocator){
+      Arena = Allocator.Arena;
+    }
+
+    type* allocate(size_t Count){
+      if(Arena) return (type*)Arena->Allocate(Count*sizeof(type), alignof(type));
+      return (type*)::operator new(Count*sizeof(type));
+    }
+    void deallocate(type* Data, size_t Count){
+      if(!Arena) ::operator delete(Data);
+    }
+};
+
+template<class A, class B>
+bool operator== (const ARENA_ALLOCATOR<A>& Left, const ARENA_ALLOCATOR<B>& Right){
+  return Left.Arena == Right.Arena;
+}
+template<class A, class B>
+bool operator!= (const ARENA_ALLOCATOR<A>& Left, const ARENA_ALLOCATOR<B>& Right){
+  return Left.Arena != Right.Arena;
+}
+//------------------------------------------------------------------------------
+
+#endif
+//------------------------------------------------------------------------------
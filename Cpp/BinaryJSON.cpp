@@ -0,0 +1,852 @@
+/*==============================================================================
+
+Copyright (C) John-Philip Taylor
+jpt13653903@gmail.com
+
+This file is part of a library
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+==============================================================================*/
+
+#include "BinaryJSON.h"
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+//------------------------------------------------------------------------------
+
+using namespace std;
+//------------------------------------------------------------------------------
+
+// Floats that are exactly representable in single precision are written as
+// such, which halves their size without changing the value
+static bool IsSingle(double Value){
+  return fabs(Value) <= FLT_MAX && (double)(float)Value == Value;
+}
+//------------------------------------------------------------------------------
+
+static uint32_t SingleBits(double Value){
+  float    Single = (float)Value;
+  uint32_t Bits;
+  memcpy(&Bits, &Single, 4);
+  return Bits;
+}
+//------------------------------------------------------------------------------
+
+static uint64_t DoubleBits(double Value){
+  uint64_t Bits;
+  memcpy(&Bits, &Value, 8);
+  return Bits;
+}
+//------------------------------------------------------------------------------
+
+static double FromSingle(uint64_t Bits){
+  uint32_t Word = (uint32_t)Bits;
+  float    Single;
+  memcpy(&Single, &Word, 4);
+  return Single;
+}
+//------------------------------------------------------------------------------
+
+static double FromDouble(uint64_t Bits){
+  double Value;
+  memcpy(&Value, &Bits, 8);
+  return Value;
+}
+//------------------------------------------------------------------------------
+
+// RFC 8949, Appendix D
+static double FromHalf(unsigned Half){
+  int    Exponent = (Half >> 10) & 0x1F;
+  int    Mantissa =  Half        & 0x3FF;
+  double Value;
+
+  if     (Exponent ==  0) Value = ldexp(Mantissa, -24);
+  else if(Exponent != 31) Value = ldexp(Mantissa + 1024, Exponent - 25);
+  else                    Value = Mantissa ? NAN : INFINITY;
+
+  return (Half & 0x8000) ? -Value : Value;
+}
+//------------------------------------------------------------------------------
+
+BINARY_WRITER::BINARY_WRITER(){
+  Buffer   = 0;
+  Capacity = 0;
+  Used     = 0;
+  Hint     = Unknown;
+}
+//------------------------------------------------------------------------------
+
+BINARY_WRITER::~BINARY_WRITER(){
+  free(Buffer);
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::Clear(){
+  Used = 0;
+  Hint = Unknown;
+  Stack.clear();
+}
+//------------------------------------------------------------------------------
+
+const uint8_t* BINARY_WRITER::GetBuffer(){
+  return Buffer;
+}
+//------------------------------------------------------------------------------
+
+size_t BINARY_WRITER::GetLength(){
+  return Used;
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::MakeRoom(size_t Length){
+  size_t Size = Capacity ? 2*Capacity : 0x100;
+  while(Size < Used + Length) Size *= 2;
+  uint8_t* Data = (uint8_t*)realloc(Buffer, Size);
+  if(!Data) throw std::bad_alloc();
+  Buffer   = Data;
+  Capacity = Size;
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::Write(const void* Data, size_t Length){
+  if(!Length) return;
+  if(Used + Length > Capacity) MakeRoom(Length);
+  memcpy(Buffer + Used, Data, Length);
+  Used += Length;
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::Write(uint8_t Byte){
+  if(Used == Capacity) MakeRoom(1);
+  Buffer[Used++] = Byte;
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::WriteBig(uint64_t Value, int Bytes){
+  if(Used + Bytes > Capacity) MakeRoom(Bytes);
+  for(int n = Bytes-1; n >= 0; n--) Buffer[Used++] = (uint8_t)(Value >> 8*n);
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::BeginValue(){
+  if(!Stack.empty()) Stack.back().Count++;
+}
+//------------------------------------------------------------------------------
+
+void BINARY_WRITER::BeginContainer(){
+  BeginValue();
+
+  CONTAINER Container;
+  Container.Header = Used;
+  Container.Count  = 0;
+  Container.Size   = Hint;
+  Stack.push_back(Container);
+  Hint = Unknown;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_WRITER::EndContainer(CONTAINER* Container){
+  *Container = Stack.back();
+  Stack.pop_back();
+  return Container->Size == Unknown || Container->Size == Container->Count;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_WRITER::Size(size_t Count){
+  Hint = Count;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+void CBOR_WRITER::WriteHead(int Major, uint64_t Argument){
+  uint8_t Type = (uint8_t)(Major << 5);
+
+  if(Argument < 24){
+    Write((uint8_t)(Type | Argument));
+  }else if(Argument <= 0xFF){
+    Write((uint8_t)(Type | 24));
+    Write((uint8_t)Argument);
+  }else if(Argument <= 0xFFFF){
+    Write((uint8_t)(Type | 25));
+    WriteBig(Argument, 2);
+  }else if(Argument <= 0xFFFFFFFF){
+    Write((uint8_t)(Type | 26));
+    WriteBig(Argument, 4);
+  }else{
+    Write((uint8_t)(Type | 27));
+    WriteBig(Argument, 8);
+  }
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Null(){
+  BeginValue();
+  Write((uint8_t)0xF6);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Bool(bool Value){
+  BeginValue();
+  Write((uint8_t)(Value ? 0xF5 : 0xF4));
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Number(double Value){
+  BeginValue();
+  if(IsSingle(Value)){
+    Write((uint8_t)0xFA);
+    WriteBig(SingleBits(Value), 4);
+  }else{
+    Write((uint8_t)0xFB);
+    WriteBig(DoubleBits(Value), 8);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::String(const char* Value, size_t Length){
+  BeginValue();
+  WriteHead(3, Length);
+  Write(Value, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Integer(int64_t Value){
+  BeginValue();
+  if(Value < 0) WriteHead(1, ~(uint64_t)Value); // -1 - Value
+  else          WriteHead(0,  (uint64_t)Value);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Unsigned(uint64_t Value){
+  BeginValue();
+  WriteHead(0, Value);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::StartObject(){
+  BeginContainer();
+  if(Stack.back().Size == Unknown) Write((uint8_t)0xBF);
+  else                             WriteHead(5, Stack.back().Size);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::Key(const char* Name, size_t Length){
+  WriteHead(3, Length);
+  Write(Name, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::End(){
+  CONTAINER Container;
+  bool      Result = EndContainer(&Container);
+  if(Container.Size == Unknown) Write((uint8_t)0xFF); // Break
+  return Result;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::EndObject(){
+  return End();
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::StartArray(){
+  BeginContainer();
+  if(Stack.back().Size == Unknown) Write((uint8_t)0x9F);
+  else                             WriteHead(4, Stack.back().Size);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_WRITER::EndArray(){
+  return End();
+}
+//------------------------------------------------------------------------------
+
+void MSGPACK_WRITER::WriteHead(uint8_t Fix, uint8_t Base, size_t Count){
+  if(Count < 16){
+    Write((uint8_t)(Fix | Count));
+  }else if(Count <= 0xFFFF){
+    Write(Base);
+    WriteBig(Count, 2);
+  }else{
+    Write((uint8_t)(Base + 1));
+    WriteBig(Count, 4);
+  }
+}
+//------------------------------------------------------------------------------
+
+void MSGPACK_WRITER::WriteUnsigned(uint64_t Value){
+  if(Value < 0x80){
+    Write((uint8_t)Value);
+  }else if(Value <= 0xFF){
+    Write((uint8_t)0xCC);
+    Write((uint8_t)Value);
+  }else if(Value <= 0xFFFF){
+    Write((uint8_t)0xCD);
+    WriteBig(Value, 2);
+  }else if(Value <= 0xFFFFFFFF){
+    Write((uint8_t)0xCE);
+    WriteBig(Value, 4);
+  }else{
+    Write((uint8_t)0xCF);
+    WriteBig(Value, 8);
+  }
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::WriteText(const char* Value, size_t Length){
+  if(Length < 32){
+    Write((uint8_t)(0xA0 | Length));
+  }else if(Length <= 0xFF){
+    Write((uint8_t)0xD9);
+    Write((uint8_t)Length);
+  }else if(Length <= 0xFFFF){
+    Write((uint8_t)0xDA);
+    WriteBig(Length, 2);
+  }else if((uint64_t)Length <= 0xFFFFFFFF){
+    Write((uint8_t)0xDB);
+    WriteBig(Length, 4);
+  }else{
+    return false;
+  }
+  Write(Value, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Null(){
+  BeginValue();
+  Write((uint8_t)0xC0);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Bool(bool Value){
+  BeginValue();
+  Write((uint8_t)(Value ? 0xC3 : 0xC2));
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Number(double Value){
+  BeginValue();
+  if(IsSingle(Value)){
+    Write((uint8_t)0xCA);
+    WriteBig(SingleBits(Value), 4);
+  }else{
+    Write((uint8_t)0xCB);
+    WriteBig(DoubleBits(Value), 8);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::String(const char* Value, size_t Length){
+  BeginValue();
+  return WriteText(Value, Length);
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Integer(int64_t Value){
+  BeginValue();
+
+  if(Value >= 0){
+    WriteUnsigned((uint64_t)Value);
+  }else if(Value >= -32){ // Negative fixint
+    Write((uint8_t)Value);
+  }else if(Value >= INT8_MIN){
+    Write((uint8_t)0xD0);
+    WriteBig((uint64_t)Value, 1);
+  }else if(Value >= INT16_MIN){
+    Write((uint8_t)0xD1);
+    WriteBig((uint64_t)Value, 2);
+  }else if(Value >= INT32_MIN){
+    Write((uint8_t)0xD2);
+    WriteBig((uint64_t)Value, 4);
+  }else{
+    Write((uint8_t)0xD3);
+    WriteBig((uint64_t)Value, 8);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Unsigned(uint64_t Value){
+  BeginValue();
+  WriteUnsigned(Value);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Begin(uint8_t Fix, uint8_t Base){
+  BeginContainer();
+
+  size_t Size = Stack.back().Size;
+  if(Size == Unknown){
+    WriteBig(0, 5); // Reserved for the largest header
+  }else{
+    if((uint64_t)Size > 0xFFFFFFFF) return false;
+    WriteHead(Fix, Base, Size);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::End(uint8_t Fix, uint8_t Base){
+  CONTAINER Container;
+  if(!EndContainer(&Container)) return false;
+  if(Container.Size != Unknown) return true;
+  if((uint64_t)Container.Count > 0xFFFFFFFF) return false;
+
+  // Write the header in the reserved space and close the gap, if any
+  size_t Body   = Container.Header + 5;
+  size_t Length = Used - Body;
+  Used = Container.Header;
+  WriteHead(Fix, Base, Container.Count);
+  if(Used < Body) memmove(Buffer + Used, Buffer + Body, Length);
+  Used += Length;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::StartObject(){
+  return Begin(0x80, 0xDE);
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::Key(const char* Name, size_t Length){
+  return WriteText(Name, Length);
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::EndObject(){
+  return End(0x80, 0xDE);
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::StartArray(){
+  return Begin(0x90, 0xDC);
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_WRITER::EndArray(){
+  return End(0x90, 0xDC);
+}
+//------------------------------------------------------------------------------
+
+BINARY_READER::BINARY_READER(const char* Format){
+  this->Format = Format;
+  Handler      = 0;
+  Data         = 0;
+  Length       = 0;
+  Index        = 0;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_READER::Error(const char* Message){
+  static std::atomic<bool> FirstError(true); // Readers can run concurrently
+  if(FirstError.exchange(false)){
+    error("%s error at offset %llu:\n  %s",
+          Format, (unsigned long long)Index, Message);
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_READER::ReadBig(uint64_t* Value, int Bytes){
+  *Value = 0;
+  if(Length - Index < (size_t)Bytes) return Error("Unexpected end of data");
+
+  for(int n = 0; n < Bytes; n++) *Value = (*Value << 8) | Data[Index++];
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_READER::ReadBytes(const uint8_t** Bytes, size_t Count){
+  if(Length - Index < Count) return Error("Unexpected end of data");
+
+  *Bytes = Data + Index;
+  Index += Count;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_READER::Parse(JSON_HANDLER* Handler, const void* Data, size_t Length){
+  this->Handler = Handler;
+  this->Data    = (const uint8_t*)Data;
+  this->Length  = Length;
+  Index         = 0;
+
+  if(!ReadValue()) return false;
+  if(Index < Length) return Error("Unexpected data after the value");
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool BINARY_READER::Parse(JSON* Document, const void* Data, size_t Length, unsigned Flags){
+  Document->BeginParse(Flags & JSON::pfArena);
+
+  JSON::BUILDER Builder(Document, 0, false, Flags & JSON::pfPacked);
+  return Parse(&Builder, Data, Length);
+}
+//------------------------------------------------------------------------------
+
+CBOR_READER::CBOR_READER(): BINARY_READER("CBOR"){
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadHead(uint8_t Initial, uint64_t* Argument, bool* Indefinite){
+  int Info = Initial & 0x1F;
+
+  *Argument   = 0;
+  *Indefinite = false;
+  if(Info < 24){
+    *Argument = (uint64_t)Info;
+    return true;
+  }
+  if(Info < 28) return ReadBig(Argument, 1 << (Info - 24));
+  if(Info == 31){
+    *Indefinite = true;
+    return true;
+  }
+  return Error("Reserved additional information");
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadBreak(bool* Found){
+  *Found = false;
+  if(Index >= Length) return Error("Unexpected end of data");
+
+  *Found = Data[Index] == 0xFF;
+  if(*Found) Index++;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadText(
+  uint64_t     Argument,
+  bool         Indefinite,
+  const char** Text,
+  size_t*      Size
+){
+  const uint8_t* Bytes;
+
+  if(!Indefinite){
+    if(Argument > Length - Index) return Error("Unexpected end of data");
+    if(!ReadBytes(&Bytes, (size_t)Argument)) return false;
+    *Text = (const char*)Bytes;
+    *Size = (size_t)Argument;
+    return true;
+  }
+
+  // A sequence of definite-length chunks, terminated by a break
+  Scratch.clear();
+  for(;;){
+    bool Found;
+    if(!ReadBreak(&Found)) return false;
+    if( Found) break;
+
+    uint8_t  Initial = Data[Index++];
+    uint64_t Chunk;
+    bool     Nested;
+    if((Initial >> 5) != 3) return Error("Invalid chunk in a text string");
+    if(!ReadHead(Initial, &Chunk, &Nested)) return false;
+    if(Nested) return Error("Invalid chunk in a text string");
+    if(Chunk > Length - Index) return Error("Unexpected end of data");
+    if(!ReadBytes(&Bytes, (size_t)Chunk)) return false;
+    Scratch.append((const char*)Bytes, (size_t)Chunk);
+  }
+  *Text = Scratch.data();
+  *Size = Scratch.size();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadArray(uint64_t Count, bool Indefinite){
+  if(Indefinite){
+    if(!Handler->StartArray()) return false;
+    for(;;){
+      bool Found;
+      if(!ReadBreak(&Found)) return false;
+      if( Found) break;
+      if(!ReadValue()) return false;
+    }
+    return Handler->EndArray();
+  }
+
+  // Every item takes at least one byte, which bounds the size hint
+  if(Count > Length - Index) return Error("Unexpected end of data");
+
+  if(!Handler->Size((size_t)Count)) return false;
+  if(!Handler->StartArray()) return false;
+  for(uint64_t n = 0; n < Count; n++){
+    if(!ReadValue()) return false;
+  }
+  return Handler->EndArray();
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadMap(uint64_t Count, bool Indefinite){
+  // Every member takes at least two bytes, which bounds the size hint
+  if(!Indefinite){
+    if(Count > (Length - Index) / 2) return Error("Unexpected end of data");
+    if(!Handler->Size((size_t)Count)) return false;
+  }
+  if(!Handler->StartObject()) return false;
+
+  for(uint64_t n = 0; Indefinite || n < Count; n++){
+    if(Indefinite){
+      bool Found;
+      if(!ReadBreak(&Found)) return false;
+      if( Found) break;
+    }
+    if(Index >= Length) return Error("Unexpected end of data");
+
+    uint8_t     Initial = Data[Index++];
+    uint64_t    Argument;
+    bool        Chunked;
+    const char* Name;
+    size_t      Size;
+    if((Initial >> 5) != 3) return Error("Only string keys are supported");
+    if(!ReadHead(Initial, &Argument, &Chunked)) return false;
+    if(!ReadText(Argument, Chunked, &Name, &Size)) return false;
+    if(!Handler->Key(Name, Size)) return false;
+    if(!ReadValue()) return false;
+  }
+  return Handler->EndObject();
+}
+//------------------------------------------------------------------------------
+
+bool CBOR_READER::ReadValue(){
+  if(Index >= Length) return Error("Unexpected end of data");
+
+  uint8_t  Initial = Data[Index++];
+  int      Major   = Initial >> 5;
+  uint64_t Argument;
+  bool     Indefinite;
+
+  if(Major == 7){
+    switch(Initial & 0x1F){
+      case 20: return Handler->Bool(false);
+      case 21: return Handler->Bool(true );
+      case 22: // null
+      case 23: // undefined
+        return Handler->Null();
+
+      case 25:
+        if(!ReadBig(&Argument, 2)) return false;
+        return Handler->Number(FromHalf((unsigned)Argument));
+
+      case 26:
+        if(!ReadBig(&Argument, 4)) return false;
+        return Handler->Number(FromSingle(Argument));
+
+      case 27:
+        if(!ReadBig(&Argument, 8)) return false;
+        return Handler->Number(FromDouble(Argument));
+
+      case 31:
+        return Error("Unexpected break");
+
+      default:
+        return Error("Unsupported simple value");
+    }
+  }
+
+  if(!ReadHead(Initial, &Argument, &Indefinite)) return false;
+  if(Indefinite && (Major < 2 || Major == 6)){
+    return Error("Invalid indefinite length");
+  }
+
+  switch(Major){
+    case 0:
+      if(Argument <= INT64_MAX) return Handler->Integer((int64_t)Argument);
+      return Handler->Unsigned(Argument);
+
+    case 1: // -1 - Argument
+      if(Argument <= INT64_MAX) return Handler->Integer(-1 - (int64_t)Argument);
+      return Handler->Number(-1.0 - (double)Argument);
+
+    case 2:
+      return Error("Byte strings are not supported");
+
+    case 3:{
+      const char* Text;
+      size_t      Size;
+      if(!ReadText(Argument, Indefinite, &Text, &Size)) return false;
+      return Handler->String(Text, Size);
+    }
+
+    case 4:
+      return ReadArray(Argument, Indefinite);
+
+    case 5:
+      return ReadMap(Argument, Indefinite);
+
+    default: // Tags are ignored
+      return ReadValue();
+  }
+}
+//------------------------------------------------------------------------------
+
+MSGPACK_READER::MSGPACK_READER(): BINARY_READER("MessagePack"){
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_READER::ReadText(uint8_t Type, const char** Text, size_t* Size){
+  uint64_t       Count;
+  const uint8_t* Bytes;
+
+  if(Type < 0xC0) Count = Type & 0x1F; // fixstr
+  else if(!ReadBig(&Count, 1 << (Type - 0xD9))) return false;
+
+  if(Count > Length - Index) return Error("Unexpected end of data");
+  if(!ReadBytes(&Bytes, (size_t)Count)) return false;
+  *Text = (const char*)Bytes;
+  *Size = (size_t)Count;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_READER::ReadArray(uint64_t Count){
+  // Every item takes at least one byte, which bounds the size hint
+  if(Count > Length - Index) return Error("Unexpected end of data");
+
+  if(!Handler->Size((size_t)Count)) return false;
+  if(!Handler->StartArray()) return false;
+  for(uint64_t n = 0; n < Count; n++){
+    if(!ReadValue()) return false;
+  }
+  return Handler->EndArray();
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_READER::ReadMap(uint64_t Count){
+  // Every member takes at least two bytes, which bounds the size hint
+  if(Count > (Length - Index) / 2) return Error("Unexpected end of data");
+
+  if(!Handler->Size((size_t)Count)) return false;
+  if(!Handler->StartObject()) return false;
+  for(uint64_t n = 0; n < Count; n++){
+    if(Index >= Length) return Error("Unexpected end of data");
+
+    uint8_t     Type = Data[Index++];
+    const char* Name;
+    size_t      Size;
+    if((Type < 0xA0 || Type >= 0xC0) && (Type < 0xD9 || Type > 0xDB)){
+      return Error("Only string keys are supported");
+    }
+    if(!ReadText(Type, &Name, &Size)) return false;
+    if(!Handler->Key(Name, Size)) return false;
+    if(!ReadValue()) return false;
+  }
+  return Handler->EndObject();
+}
+//------------------------------------------------------------------------------
+
+bool MSGPACK_READER::ReadValue(){
+  if(Index >= Length) return Error("Unexpected end of data");
+
+  uint8_t  Type = Data[Index++];
+  uint64_t Value;
+
+  if(Type <  0x80) return Handler->Integer(Type); // Positive fixint
+  if(Type <  0x90) return ReadMap  (Type & 0x0F);
+  if(Type <  0xA0) return ReadArray(Type & 0x0F);
+  if(Type >= 0xE0) return Handler->Integer((int8_t)Type); // Negative fixint
+
+  if(Type < 0xC0){
+    const char* Text;
+    size_t      Size;
+    if(!ReadText(Type, &Text, &Size)) return false;
+    return Handler->String(Text, Size);
+  }
+
+  switch(Type){
+    case 0xC0: return Handler->Null();
+    case 0xC2: return Handler->Bool(false);
+    case 0xC3: return Handler->Bool(true );
+
+    case 0xCA:
+      if(!ReadBig(&Value, 4)) return false;
+      return Handler->Number(FromSingle(Value));
+
+    case 0xCB:
+      if(!ReadBig(&Value, 8)) return false;
+      return Handler->Number(FromDouble(Value));
+
+    case 0xCC: // uint 8, 16, 32 and 64
+    case 0xCD:
+    case 0xCE:
+    case 0xCF:
+      if(!ReadBig(&Value, 1 << (Type - 0xCC))) return false;
+      if(Value <= INT64_MAX) return Handler->Integer((int64_t)Value);
+      return Handler->Unsigned(Value);
+
+    case 0xD0:
+      if(!ReadBig(&Value, 1)) return false;
+      return Handler->Integer((int8_t)Value);
+
+    case 0xD1:
+      if(!ReadBig(&Value, 2)) return false;
+      return Handler->Integer((int16_t)Value);
+
+    case 0xD2:
+      if(!ReadBig(&Value, 4)) return false;
+      return Handler->Integer((int32_t)Value);
+
+    case 0xD3:
+      if(!ReadBig(&Value, 8)) return false;
+      return Handler->Integer((int64_t)Value);
+
+    case 0xD9: // str 8, 16 and 32
+    case 0xDA:
+    case 0xDB:{
+      const char* Text;
+      size_t      Size;
+      if(!ReadText(Type, &Text, &Size)) return false;
+      return Handler->String(Text, Size);
+    }
+
+    case 0xDC:
+    case 0xDD:
+      if(!ReadBig(&Value, Type == 0xDC ? 2 : 4)) return false;
+      return ReadArray(Value);
+
+    case 0xDE:
+    case 0xDF:
+      if(!ReadBig(&Value, Type == 0xDE ? 2 : 4)) return false;
+      return ReadMap(Value);
+
+    case 0xC4: // bin 8, 16 and 32
+    case 0xC5:
+    case 0xC6:
+      return Error("Binary data is not supported");
+
+    case 0xC7: // ext 8, 16 and 32
+    case 0xC8:
+    case 0xC9:
+    case 0xD4: // fixext 1, 2, 4, 8 and 16
+    case 0xD5:
+    case 0xD6:
+    case 0xD7:
+    case 0xD8:
+      return Error("Extension types are not supported");
+
+    default: // 0xC1
+      return Error("Invalid type");
+  }
+}
+//------------------------------------------------------------------------------
@@ -0,0 +1,190 @@
+//==============================================================================
+// Copyright (C) John-Philip Taylor
+// jpt13653903@gmail.com
+//
+// This file is part of a library
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//==============================================================================
+
+// Binary encodings of the JSON data model: CBOR (RFC 8949) and MessagePack.
+//
+// The writers are JSON event handlers, so that they can be driven by a
+// document (JSON::Emit), by a JSON_READER (to convert a text file) or by one
+// of the binary readers (to convert between the two encodings).  The readers
+// report the same events as JSON_READER, or build a document directly.
+//
+// Only values that JSON can represent are supported: byte strings, extension
+// types, non-string keys and simple values other than false, true, null and
+// undefined (read as null) are errors.  CBOR tags are ignored.
+//------------------------------------------------------------------------------
+
+#ifndef BinaryJSON_h
+#define BinaryJSON_h
+//------------------------------------------------------------------------------
+
+#include "JSON.h"
+//------------------------------------------------------------------------------
+
+// The output buffer and open containers common to both writers
+class BINARY_WRITER: public JSON_HANDLER{
+  protected:
+    struct CONTAINER{
+      size_t Header; // Offset of the header in the buffer
+      size_t Count;  // Values written so far
+      size_t Size;   // From the Size() event, or "Unknown"
+    };
+    static const size_t Unknown = (size_t)-1;
+
+    uint8_t*               Buffer;
+    size_t                 Capacity;
+    size_t                 Used;
+    size_t                 Hint;  // Argument of the last Size() event
+    std::vector<CONTAINER> Stack; // Open objects and arrays
+
+    void MakeRoom(size_t Length);
+    void Write   (const void* Data, size_t Length);
+    void Write   (uint8_t Byte);
+    void WriteBig(uint64_t Value, int Bytes); // Big-endian
+
+    // Counts a value in the enclosing container
+    void BeginValue();
+
+    // Opens a container, which takes over the size hint
+    void BeginContainer();
+
+    // Closes a container: false if it did not match its size hint
+    bool EndContainer(CONTAINER* Container);
+
+  public:
+    BINARY_WRITER();
+   ~BINARY_WRITER();
+    BINARY_WRITER(const BINARY_WRITER&) = delete;
+    BINARY_WRITER& operator= (const BINARY_WRITER&) = delete;
+
+    // Discards the output, so that the writer can be reused
+    void Clear();
+
+    // The output so far, which is complete once the top-level value ends
+    const uint8_t* GetBuffer();
+    size_t         GetLength();
+
+    bool Size(size_t Count);
+};
+//------------------------------------------------------------------------------
+
+// Containers with a size hint (documents always provide one) are written
+// with definite lengths, and the rest as indefinite-length items.
+class CBOR_WRITER: public BINARY_WRITER{
+  private:
+    void WriteHead(int Major, uint64_t Argument);
+    bool End      ();
+
+  public:
+    bool Null  ();
+    bool Bool  (bool        Value);
+    bool Number(double      Value);
+    bool String(const char* Value, size_t Length);
+
+    bool Integer (int64_t  Value);
+    bool Unsigned(uint64_t Value);
+
+    bool StartObject();
+    bool Key        (const char* Name, size_t Length);
+    bool EndObject  ();
+
+    bool StartArray();
+    bool EndArray  ();
+};
+//------------------------------------------------------------------------------
+
+// MessagePack has no indefinite lengths: containers without a size hint
+// reserve the largest header, which is shrunk to fit when they end.
+class MSGPACK_WRITER: public BINARY_WRITER{
+  private:
+    void WriteHead    (uint8_t Fix, uint8_t Base, size_t Count); // Map or array
+    void WriteUnsigned(uint64_t Value);
+    bool WriteText    (const char* Value, size_t Length);
+    bool Begin        (uint8_t Fix, uint8_t Base);
+    bool End          (uint8_t Fix, uint8_t Base);
+
+  public:
+    bool Null  ();
+    bool Bool  (bool        Value);
+    bool Number(double      Value);
+    bool String(const char* Value, size_t Length);
+
+    bool Integer (int64_t  Value);
+    bool Unsigned(uint64_t Value);
+
+    bool StartObject();
+    bool Key        (const char* Name, size_t Length);
+    bool EndObject  ();
+
+    bool StartArray();
+    bool EndArray  ();
+};
+//------------------------------------------------------------------------------
+
+// The input and error reporting common to both readers
+class BINARY_READER{
+  protected:
+    const char*    Format;  // For error messages
+    JSON_HANDLER*  Handler;
+    const uint8_t* Data;
+    size_t         Length;
+    size_t         Index;
+    std::string    Scratch; // Indefinite-length strings
+
+    bool Error(const char* Message);
+
+    // Bounds-checked reads, which report an error at the end of the input
+    bool ReadBig  (uint64_t* Value, int Bytes); // Big-endian
+    bool ReadBytes(const uint8_t** Bytes, size_t Count);
+
+    virtual bool ReadValue() = 0;
+
+  public:
+    BINARY_READER(const char* Format);
+    virtual ~BINARY_READER(){}
+
+    // Reports a single value to the handler.  Returns false on error, or if
+    // the handler stopped the parse.
+    bool Parse(JSON_HANDLER* Handler, const void* Data, size_t Length);
+
+    // Builds a document, discarding its previous contents.  Only "pfArena"
+    // and "pfPacked" apply to binary input.
+    bool Parse(JSON* Document, const void* Data, size_t Length, unsigned Flags = 0);
+};
+//------------------------------------------------------------------------------
+
+class CBOR_READER: public BINARY_READER{
+  private:
+    bool ReadHead (uint8_t Initial, uint64_t* Argument, bool* Indefinite);
+    bool ReadText (uint64_t Argument, bool Indefinite, const char** Text, size_t* Size);
+    bool ReadBreak(bool* Found);
+    bool ReadArray(uint64_t Count, bool Indefinite);
+    bool ReadMap  (uint64_t Count, bool Indefinite);
+    bool ReadValue();
+
+  public:
+    CBOR_READER();
+};
+//------------------------------------------------------------------------------
+
+class MSGPACK_READER: public BINARY_READER{
+  private:
+    bool ReadText (uint8_t Type, const char** Text, size_t* Size);
+    bool ReadArray(uint64_t Count);
+    bool ReadMap  (uint64_t Count);
+    bool ReadValue();
+
+  public:
+    MSGPACK_READER();
+};
+//------------------------------------------------------------------------------
+
+#endif
+//------------------------------------------------------------------------------
@@ -27,12 +27,15 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 FILE_WRAPPER::FILE_WRAPPER(){
-  Handle = INVALID_HANDLE_VALUE;
+  Handle  = INVALID_HANDLE_VALUE;
+  MapView = 0;
+  MapSize = 0;
 }
 //------------------------------------------------------------------------------
 
 FILE_WRAPPER::~FILE_WRAPPER(){
   Close();
+  Unmap();
 }
 //------------------------------------------------------------------------------
 
@@ -253,6 +256,79 @@ byte* FILE_WRAPPER::ReadAll(const char* Filename, uint64_t* Filesize){
 }
 //------------------------------------------------------------------------------
 
+const byte* FILE_WRAPPER::Map(const char* Filename, uint64_t* Filesize){
+  Unmap();
+
+  if(!Open(Filename, faRead)) return 0;
+  uint64_t Size = GetSize();
+  if(Filesize) *Filesize = Size;
+
+  #if defined(WINVER)
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+
+    // The tail of the last page is zero-filled, which provides the null
+    // terminator, unless the file fills the last page exactly.
+    if(!Size || !(Size % Info.dwPageSize)){
+      Close();
+      MapView = ReadAll(Filename);
+      MapCopy = true;
+      return MapView;
+    }
+    HANDLE Mapping = CreateFileMapping(Handle, 0, PAGE_READONLY, 0, 0, 0);
+    Close();
+    if(!Mapping) return 0;
+
+    MapView = (byte*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    MapCopy = false;
+    CloseHandle(Mapping);
+    return MapView;
+
+  #elif defined(NIX)
+    if(Size > SIZE_MAX - 0x10000){
+      Close();
+      return 0;
+    }
+    // Reserve at least one page more than the file needs, so that the
+    // byte following the file is always a readable zero
+    size_t Page = sysconf(_SC_PAGESIZE);
+    MapSize = (Size + Page) & ~(uint64_t)(Page - 1);
+
+    void* View = mmap(0, MapSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(View == MAP_FAILED){
+      Close();
+      return 0;
+    }
+    if(Size && mmap(
+      View, Size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fileno(Handle), 0
+    ) == MAP_FAILED){
+      munmap(View, MapSize);
+      Close();
+      return 0;
+    }
+    Close();
+
+    MapView = (byte*)View;
+    return MapView;
+  #endif
+}
+//------------------------------------------------------------------------------
+
+void FILE_WRAPPER::Unmap(){
+  if(!MapView) return;
+
+  #if defined(WINVER)
+    if(MapCopy) delete[] MapView;
+    else        UnmapViewOfFile(MapView);
+  #elif defined(NIX)
+    munmap(MapView, MapSize);
+  #endif
+
+  MapView = 0;
+  MapSize = 0;
+}
+//------------------------------------------------------------------------------
+
 bool FILE_WRAPPER::CreatePath(const char* Filename){
   #ifdef WINVER
     wstring Path;
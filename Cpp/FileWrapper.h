@@ -42,6 +42,12 @@ class FILE_WRAPPER{
       FILE*       Handle;
     #endif
 
+    byte*    MapView; // Null-terminated view of the mapped file
+    uint64_t MapSize; // Bytes reserved for the view
+    #if defined(WINVER)
+      bool   MapCopy; // The view is a heap copy instead of a mapping
+    #endif
+
     void GetLongName(const wchar_t* Filename, std::wstring& LongName);
     bool CreatePath (const char* Filename);
 
@@ -65,6 +71,12 @@ class FILE_WRAPPER{
     // The caller must free the returned buffer with "delete[]"
     byte* ReadAll(const char* Filename, uint64_t* Filesize = 0);
 
+    // Maps the whole file into memory, read-only, and closes it again.
+    // UTF-8 name; returns null on error; the view is null-terminated.
+    // The view remains valid until Unmap(), the next Map() or destruction.
+    const byte* Map  (const char* Filename, uint64_t* Filesize = 0);
+    void        Unmap();
+
     // Opens, writes and closes the file
     // UTF-8 name; also creates the path if it does not exist
     // If Size is 0, Data is assumed to be null-terminated
@@ -11,6 +11,20 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 ==============================================================================*/
 
 #include "JSON.h"
+#include "FileWrapper.h"
+//------------------------------------------------------------------------------
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+//------------------------------------------------------------------------------
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+#endif
 //------------------------------------------------------------------------------
 
 using namespace std;
@@ -44,369 +58,1237 @@ void operator+= (string& S, uint32_t Char){
 void operator+= (string& S, uint16_t Char){ S += (uint32_t)Char; }
 //------------------------------------------------------------------------------
 
-JSON::JSON(){
-  Type   = typeNull;
-  String = "";
-  Number = 0;
+JSON::STRING::STRING(){
+  Local[0] = 0;
+  Data     = Local;
+  Length   = 0;
+  State    = sLocal;
 }
 //------------------------------------------------------------------------------
 
-JSON::JSON(JSON& Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
+JSON::STRING::STRING(const STRING& Value){
+  Local[0] = 0;
+  Data     = Local;
+  Length   = 0;
+  State    = sLocal;
+  Assign(Value.Data, Value.Length);
 }
 //------------------------------------------------------------------------------
 
-JSON::JSON(const char* Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
-}
-//------------------------------------------------------------------------------
+JSON::STRING::STRING(STRING&& Value) noexcept{
+  Length = Value.Length;
+  State  = Value.State;
 
-JSON::JSON(int Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
+  if(State == sLocal){
+    memcpy(Local, Value.Local, Length+1);
+    Data = Local;
+  }else{
+    Data = Value.Data;
+  }
+  Value.Local[0] = 0;
+  Value.Data     = Value.Local;
+  Value.Length   = 0;
+  Value.State    = sLocal;
 }
 //------------------------------------------------------------------------------
 
-JSON::JSON(unsigned Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
+JSON::STRING::~STRING(){
+  Release();
 }
 //------------------------------------------------------------------------------
 
-JSON::JSON(double Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
+void JSON::STRING::Release(){
+  if(State == sHeap) delete[] Data;
+  Local[0] = 0;
+  Data     = Local;
+  Length   = 0;
+  State    = sLocal;
 }
 //------------------------------------------------------------------------------
 
-JSON::JSON(bool Value){
-  Type    = typeNull;
-  String  = "";
-  Number  = 0;
-  operator=(Value);
+JSON::STRING& JSON::STRING::operator= (const STRING& Value){
+  if(&Value != this) Assign(Value.Data, Value.Length);
+  return *this;
 }
 //------------------------------------------------------------------------------
 
-JSON::~JSON(){
-  Clear();
+JSON::STRING& JSON::STRING::operator= (const char* Value){
+  Assign(Value, strlen(Value));
+  return *this;
 }
 //------------------------------------------------------------------------------
 
-void JSON::Clear(){
-  String = "";
-  Number = 0;
+void JSON::STRING::Assign(const char* Value, size_t Length, ARENA* Arena){
+  char* Buffer;
 
-  for(
-    auto Object = Objects.begin();
-    Object != Objects.end();
-    Object++
-  ) delete Object->second;
-  Objects.clear();
+  if(Length < sizeof(Local)){
+    if(State == sHeap) Release();
+    Buffer = Local;
+    State  = sLocal;
 
-  for(size_t n = 0; n < Items.size(); n++) delete Items[n];
-  Items.clear();
+  }else if((State == sHeap || State == sArena) && Length <= this->Length){
+    // Reuse the current allocation, which matters most for arena memory
+    Buffer = (char*)Data;
+
+  }else{
+    Release();
+    if(Arena){
+      Buffer = (char*)Arena->Allocate(Length+1, 1);
+      State  = sArena;
+    }else{
+      Buffer = new char[Length+1];
+      State  = sHeap;
+    }
+  }
+  memmove(Buffer, Value, Length);
+  Buffer[Length] = 0;
 
-  Type = typeNull;
+  Data         = Buffer;
+  this->Length = Length;
 }
 //------------------------------------------------------------------------------
 
-void JSON::operator=(JSON& Value){
-  Clear();
-  Type = Value.Type;
-
-  switch(Value.Type){
-    case typeNull:
-    case typeTrue:
-    case typeFalse:
-      break;
+void JSON::STRING::View(const char* Value, size_t Length){
+  Release();
+  Data         = Value;
+  this->Length = Length;
+  State        = sView;
+}
+//------------------------------------------------------------------------------
 
-    case typeString:
-      String = Value.String;
-      break;
+bool JSON::STRING::operator< (const STRING& Value) const{
+  int Result = memcmp(Data, Value.Data, Length < Value.Length ? Length : Value.Length);
+  if(Result) return Result < 0;
+  return Length < Value.Length;
+}
+//------------------------------------------------------------------------------
 
-    case typeNumber:
-      Number = Value.Number;
-      break;
+bool JSON::STRING::operator== (const STRING& Value) const{
+  return Length == Value.Length && !memcmp(Data, Value.Data, Length);
+}
+//------------------------------------------------------------------------------
 
-    case typeObject:
-      for(
-        auto Object = Value.Objects.begin();
-        Object != Value.Objects.end();
-        Object++
-      ) AddOrUpdate(Object->first.c_str(), *(Object->second));
-      break;
+bool JSON::STRING::operator== (const char* Value) const{
+  return !strcmp(Data, Value);
+}
+//------------------------------------------------------------------------------
 
-    case typeArray:
-      for(size_t n = 0; n < Value.Items.size(); n++) Append(*(Value.Items[n]));
-      break;
+// Objects with up to this many members are searched linearly
+#define SmallObject 8
+//------------------------------------------------------------------------------
 
-    default:
-      break;
+// FNV-1a
+uint32_t JSON::OBJECTS::Hash(const char* Name, size_t Length){
+  uint32_t Hash = 0x811C9DC5;
+  for(size_t n = 0; n < Length; n++){
+    Hash ^= (uint8_t)Name[n];
+    Hash *= 0x01000193;
   }
+  return Hash;
 }
 //------------------------------------------------------------------------------
 
-void JSON::operator=(const char* Value){
-  Clear();
-  Type   = typeString;
-  String = Value;
-}
+JSON::OBJECTS::OBJECTS(ARENA* Arena):
+  Members(ARENA_ALLOCATOR<MEMBER  >(Arena)),
+  Index  (ARENA_ALLOCATOR<uint32_t>(Arena))
+{}
 //------------------------------------------------------------------------------
 
-void JSON::operator=(int Value){
-  Clear();
-  Type   = typeNumber;
-  Number = Value;
+void JSON::OBJECTS::Insert(uint32_t Member){
+  const STRING& Name = Members[Member].first;
+
+  size_t Mask = Index.size() - 1;
+  size_t Slot = Hash(Name.data(), Name.length()) & Mask;
+  while(Index[Slot]) Slot = (Slot + 1) & Mask;
+  Index[Slot] = Member + 1;
 }
 //------------------------------------------------------------------------------
 
-void JSON::operator=(unsigned Value){
-  Clear();
-  Type   = typeNumber;
-  Number = Value;
+void JSON::OBJECTS::Rehash(){
+  // Keep the load factor at or below one half
+  size_t Size = 2*SmallObject;
+  while(Size < 2*Members.size()) Size *= 2;
+
+  Index.assign(Size, 0);
+  for(uint32_t n = 0; n < Members.size(); n++) Insert(n);
 }
 //------------------------------------------------------------------------------
 
-void JSON::operator=(double Value){
-  Clear();
-  Type   = typeNumber;
-  Number = Value;
+JSON::OBJECTS::iterator JSON::OBJECTS::Scan(const char* Name, size_t Length){
+  for(auto Member = begin(); Member != end(); Member++){
+    const STRING& Key = Member->first;
+    if(Key.length() == Length && (Key.data() == Name || !memcmp(Key.data(), Name, Length))){
+      return Member;
+    }
+  }
+  return end();
 }
 //------------------------------------------------------------------------------
 
-void JSON::operator=(bool Value){
-  Clear();
-  if(Value) Type = typeTrue;
-  else      Type = typeFalse;
+JSON::OBJECTS::iterator JSON::OBJECTS::find(const char* Name, size_t Length){
+  if(Index.empty()) return Scan(Name, Length);
+  return find(Name, Length, Hash(Name, Length));
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(JSON& Value){
-  if(Value.Type == typeObject){
-    for(
-      auto Object = Value.Objects.begin();
-      Object != Value.Objects.end();
-      Object++
-    ) AddOrUpdate(Object->first.c_str(), *(Object->second));
-  }else{
-    operator=(Value);
+JSON::OBJECTS::iterator JSON::OBJECTS::find(const char* Name, size_t Length, uint32_t Hash){
+  if(Index.empty()) return Scan(Name, Length);
+
+  size_t Mask = Index.size() - 1;
+  size_t Slot = Hash & Mask;
+  while(Index[Slot]){
+    MEMBER&       Member = Members[Index[Slot] - 1];
+    const STRING& Key    = Member.first;
+    if(Key.length() == Length && (Key.data() == Name || !memcmp(Key.data(), Name, Length))){
+      return &Member;
+    }
+    Slot = (Slot + 1) & Mask;
   }
-  return this;
+  return end();
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, JSON& Value){
-  Type = typeObject;
-
-  JSON* json = operator[](Name);
-  if(json) return json->AddOrUpdate(Value);
+void JSON::OBJECTS::emplace(STRING&& Name, JSON* Value){
+  Members.emplace_back(std::move(Name), Value);
 
-  JSON* Object  = new JSON(Value);
-  Objects[Name] = Object;
+  if(Members.size() <= SmallObject) return;
 
-  return Object;
+  if(2*Members.size() > Index.size()) Rehash();
+  else                                Insert(Members.size() - 1);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, const char* Value){
-  JSON json(Value); return AddOrUpdate(Name, json);
+JSON::JSON(){
+  Init(0);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, int Value){
-  JSON json(Value); return AddOrUpdate(Name, json);
+JSON::JSON(ARENA* Arena){
+  Init(Arena);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, unsigned Value){
-  JSON json(Value); return AddOrUpdate(Name, json);
+JSON::JSON(JSON& Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, double Value){
-  JSON json(Value); return AddOrUpdate(Name, json);
+JSON::JSON(JSON&& Value){
+  // Nodes inside an arena document cannot outlive it, so they are copied
+  if(Value.Arena && !(Value.Document && Value.Document->Arena == Value.Arena)){
+    Init(0);
+    operator=(Value);
+    return;
+  }
+  Init(Value.Arena);
+  Move(Value);
+  Document       = Value.Document;
+  Value.Document = 0;
+  Value.Arena    = 0;
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name, bool Value){
-  JSON json(Value); return AddOrUpdate(Name, json);
+JSON::JSON(const char* Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::AddOrUpdate(const char* Name){
-  JSON* json = operator[](Name);
-  if(json)   return json;
-  JSON null; return AddOrUpdate(Name, null);
+JSON::JSON(int Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::operator[] (const char* Name){
-  auto Object = Objects.find(Name);
-  if(Object == Objects.end()) return 0;
-  return Object->second;
+JSON::JSON(unsigned Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(JSON& Value){
-  // If the array is empty, add any existing object as the first item in the array
-  if(Items.empty() && Type != typeNull && Type != typeArray){
-    JSON* Item = new JSON(*this);
-    Items.push_back(Item);
-  }
-  Type = typeArray;
-
-  JSON* Item = new JSON(Value);
-  Items.push_back(Item);
+JSON::JSON(int64_t Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(const char* Value){
-  JSON json(Value); Append(json);
+JSON::JSON(uint64_t Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(int Value){
-  JSON json(Value); Append(json);
+JSON::JSON(double Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(unsigned Value){
-  JSON json(Value); Append(json);
+JSON::JSON(bool Value){
+  Init(0);
+  operator=(Value);
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(double Value){
-  JSON json(Value); Append(json);
+JSON::~JSON(){
+  Clear();
+  if(Document){
+    if(Document->Arena) delete Document->Arena;
+    delete Document;
+  }
 }
 //------------------------------------------------------------------------------
 
-void JSON::Append(bool Value){
-  JSON json(Value); Append(json);
+void JSON::Init(ARENA* Arena){
+  Type        = typeNull;
+  Number      = 0;
+  Integer     = intNone;
+  this->Arena = Arena;
+  Document    = 0;
+  Parent      = 0;
+  CacheOffset = 0;
+  CacheLength = 0;
+  Cached      = false;
+  Clean       = false;
 }
 //------------------------------------------------------------------------------
 
-JSON* JSON::operator[] (int Index){
-  if(Index < 0 || (size_t)Index >= Items.size()) return 0;
-  return Items[Index];
+JSON* JSON::NewNode(){
+  JSON* Node;
+  if(Arena) Node = new(Arena->Allocate(sizeof(JSON), alignof(JSON))) JSON(Arena);
+  else      Node = new JSON;
+  Node->Parent = this;
+  return Node;
 }
 //------------------------------------------------------------------------------
 
-void JSON::ReadError(const char* Message){
-  static bool FirstError = true;
-  if(FirstError) error("JSON error on line %u:\n  %s", ReadLine, Message);
-  FirstError = false;
+void JSON::DeleteNode(JSON* Node){
+  // Everything an arena node refers to is in the same arena, so there is
+  // nothing for the destructor to release
+  if(!Arena) delete Node;
 }
 //------------------------------------------------------------------------------
 
-void JSON::ReadLineComment(){
-  ReadIndex += 2;
-  while(ReadIndex < ReadSize){
-    switch(ReadBuffer[ReadIndex]){
-      case '\n':
-        ReadLine++;
-        ReadIndex++;
-        if(ReadBuffer[ReadIndex] == '\r') ReadIndex++;
-        return;
+void JSON::Reset(){
+  Touch();
+  Cached = false;
 
-      case '\r':
-        ReadLine++;
-        ReadIndex++;
-        if(ReadBuffer[ReadIndex] == '\n') ReadIndex++;
-        return;
+  switch(Type){
+    case typeString:
+      String.~STRING();
+      break;
 
-      default:
-        ReadIndex++;
-        break;
-    }
+    case typeObject:
+      if(!Arena){
+        for(
+          auto Object = Objects.begin();
+          Object != Objects.end();
+          Object++
+        ) delete Object->second;
+        if(Lazy) delete Lazy;
+      }
+      Objects.~OBJECTS();
+      break;
+
+    case typeArray:
+      if(!Arena){
+        for(size_t n = 0; n < Items.size(); n++) delete Items[n];
+        if(Lazy){
+          if(Lazy->Packing != pkText) free(Lazy->Data);
+          delete Lazy;
+        }
+      }
+      Items.~ITEMS();
+      break;
+
+    default:
+      break;
   }
+  Type    = typeNull;
+  Number  = 0;
+  Integer = intNone;
 }
 //------------------------------------------------------------------------------
 
-void JSON::ReadBlockComment(){
-  ReadIndex += 2;
-  while(ReadIndex < ReadSize){
-    switch(ReadBuffer[ReadIndex]){
-      case '\n':
-        ReadLine++;
-        ReadIndex++;
-        if(ReadBuffer[ReadIndex] == '\r') ReadIndex++;
-        break;
+void JSON::SetType(TYPE Type){
+  Reset();
 
-      case '\r':
-        ReadLine++;
-        ReadIndex++;
-        if(ReadBuffer[ReadIndex] == '\n') ReadIndex++;
-        break;
+  switch(Type){
+    case typeString:
+      new(&String) STRING;
+      break;
 
-      case '*':
-        ReadIndex++;
-        if(ReadBuffer[ReadIndex] == '/'){
-          ReadIndex++;
-          return;
-        }
-        break;
+    case typeObject:
+      new(&Objects) OBJECTS(Arena);
+      Lazy = 0;
+      break;
 
-      default:
-        ReadIndex++;
-        break;
-    }
+    case typeArray:
+      new(&Items) ITEMS(ARENA_ALLOCATOR<JSON*>(Arena));
+      Lazy = 0;
+      break;
+
+    default:
+      break;
   }
+  this->Type = Type;
 }
 //------------------------------------------------------------------------------
 
-void JSON::ReadSpace(){
-  while(ReadIndex < ReadSize){
-    switch(ReadBuffer[ReadIndex]){
-      case '\n': ReadLine++;
-      case '\r':
-      case '\t':
-      case '\v':
-      case ' ' :
-        ReadIndex++;
-        break;
+JSON::DOCUMENT* JSON::GetDocument(){
+  if(!Document){
+    // The root of an arena document allocates it before binding the arena
+    if(Arena) Document = new(Arena->Allocate(sizeof(DOCUMENT), alignof(DOCUMENT))) DOCUMENT;
+    else      Document = new DOCUMENT;
+  }
+  return Document;
+}
+//------------------------------------------------------------------------------
 
-      case '/':
-        switch(ReadBuffer[ReadIndex+1]){
-          case '/':
-            ReadLineComment();
-            break;
-          case '*':
-            ReadBlockComment();
-            break;
-          default:
-            return;
-        }
-        break;
+bool JSON::CanMove(JSON& Value){
+  // The parse buffer of an in-situ root stays with that root
+  return Arena == Value.Arena && !(Value.Document && Value.Document->Buffer);
+}
+//------------------------------------------------------------------------------
 
-      default:
-        return;
-    }
+bool JSON::Contains(const JSON* Node) const{
+  for(Node = Node->Parent; Node; Node = Node->Parent){
+    if(Node == this) return true;
   }
+  return false;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadUnicodeSequence(std::string* String){
-  uint16_t Char = 0;
-
-  if(ReadBuffer[ReadIndex] != 'u') return false;
+void JSON::Move(JSON& Value){
+  Type    = Value.Type;
+  Number  = Value.Number;
+  Integer = Value.Integer;
+  if(Integer == intSigned  ) Signed   = Value.Signed;
+  if(Integer == intUnsigned) Unsigned = Value.Unsigned;
 
-  for(int n = 0; n < 4; n++){
-    ReadIndex++;
-    if(ReadIndex >= ReadSize) return false;
+  switch(Type){
+    case typeString:
+      new(&String) STRING(std::move(Value.String));
+      break;
 
-    if      (ReadBuffer[ReadIndex] >= '0' && ReadBuffer[ReadIndex] <= '9'){
+    case typeObject:
+      new(&Objects) OBJECTS(std::move(Value.Objects));
+      Lazy       = Value.Lazy;
+      Value.Lazy = 0;
+      for(
+        auto Object = Objects.begin();
+        Object != Objects.end();
+        Object++
+      ) Object->second->Parent = this;
+      break;
+
+    case typeArray:
+      new(&Items) ITEMS(std::move(Value.Items));
+      Lazy       = Value.Lazy;
+      Value.Lazy = 0;
+      for(size_t n = 0; n < Items.size(); n++) Items[n]->Parent = this;
+      break;
+
+    default:
+      break;
+  }
+  Value.Reset();
+}
+//------------------------------------------------------------------------------
+
+void JSON::Clear(){
+  Reset();
+  if(!Document) return;
+
+  if(Document->Arena && Arena){
+    // Move this node back to the heap before the arena memory is recycled
+    Arena = 0;
+    Document->Stringification.Assign("", 0);
+    Document->Arena->Clear();
+  }
+  if(Document->Buffer){
+    delete[] Document->Buffer;
+    Document->Buffer = 0;
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON::Touch(){
+  // A changed node has changed ancestors, so the walk can stop at the first
+  Clean = false;
+  for(JSON* Node = Parent; Node && Node->Clean; Node = Node->Parent){
+    Node->Clean = false;
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(JSON& Value){
+  if(&Value == this) return;
+
+  // Resetting this node would delete a descendant before it is copied
+  if(Contains(&Value)){
+    JSON Copy(Value);
+    operator=(std::move(Copy));
+    return;
+  }
+
+  Value.Materialise();
+  SetType(Value.Type);
+
+  switch(Value.Type){
+    case typeNull:
+    case typeTrue:
+    case typeFalse:
+      break;
+
+    case typeString:
+      String.Assign(Value.String.c_str(), Value.String.length(), Arena);
+      break;
+
+    case typeNumber:
+      Number  = Value.Number;
+      Integer = Value.Integer;
+      if(Integer == intSigned  ) Signed   = Value.Signed;
+      if(Integer == intUnsigned) Unsigned = Value.Unsigned;
+      break;
+
+    case typeObject:
+      for(
+        auto Object = Value.Objects.begin();
+        Object != Value.Objects.end();
+        Object++
+      ) AddOrUpdate(Object->first.c_str(), *(Object->second));
+      break;
+
+    case typeArray:
+      for(size_t n = 0; n < Value.Items.size(); n++) Append(*(Value.Items[n]));
+      break;
+
+    default:
+      break;
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(JSON&& Value){
+  if(&Value == this) return;
+
+  // Detach a descendant first, which resetting this node would delete
+  if(Contains(&Value)){
+    JSON Detached(std::move(Value));
+    operator=(std::move(Detached));
+    return;
+  }
+
+  if(!CanMove(Value)){
+    operator=(Value);
+    return;
+  }
+  Reset();
+  Move(Value);
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(const char* Value){
+  SetType(typeString);
+  String.Assign(Value, strlen(Value), Arena);
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(int Value){
+  operator=((int64_t)Value);
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(unsigned Value){
+  operator=((int64_t)Value);
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(int64_t Value){
+  Reset();
+  Type    = typeNumber;
+  Number  = Value;
+  Integer = intSigned;
+  Signed  = Value;
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(uint64_t Value){
+  if(Value <= INT64_MAX){
+    operator=((int64_t)Value);
+    return;
+  }
+  Reset();
+  Type     = typeNumber;
+  Number   = Value;
+  Integer  = intUnsigned;
+  Unsigned = Value;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::IsInt64() const{
+  return Type == typeNumber && Integer == intSigned;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::IsUint64() const{
+  if(Type != typeNumber) return false;
+  if(Integer == intSigned) return Signed >= 0;
+  return Integer == intUnsigned;
+}
+//------------------------------------------------------------------------------
+
+int64_t JSON::GetInt64() const{
+  if(Integer == intSigned) return Signed;
+  if(Number >= -9223372036854775808.0 && Number < 9223372036854775808.0) return (int64_t)Number;
+  return Number < 0 ? INT64_MIN : INT64_MAX;
+}
+//------------------------------------------------------------------------------
+
+uint64_t JSON::GetUint64() const{
+  if(Integer == intSigned  ) return Signed;
+  if(Integer == intUnsigned) return Unsigned;
+  if(Number >= 0 && Number < 18446744073709551616.0) return (uint64_t)Number;
+  return Number < 0 ? 0 : UINT64_MAX;
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(double Value){
+  Reset();
+  Type   = typeNumber;
+  Number = Value;
+}
+//------------------------------------------------------------------------------
+
+void JSON::operator=(bool Value){
+  Reset();
+  if(Value) Type = typeTrue;
+  else      Type = typeFalse;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(JSON& Value){
+  Value.Materialise();
+  if(Value.Type == typeObject){
+    for(
+      auto Object = Value.Objects.begin();
+      Object != Value.Objects.end();
+      Object++
+    ) AddOrUpdate(Object->first.c_str(), *(Object->second));
+  }else{
+    operator=(Value);
+  }
+  return this;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(JSON&& Value){
+  if(Value.Type == typeObject && Type == typeObject){
+    Materialise();
+    Value.Materialise();
+    for(
+      auto Object = Value.Objects.begin();
+      Object != Value.Objects.end();
+      Object++
+    ) AddOrUpdate(Object->first.c_str(), std::move(*(Object->second)));
+  }else{
+    operator=(std::move(Value));
+  }
+  return this;
+}
+//------------------------------------------------------------------------------
+
+static std::atomic<JSON_KEYS*> SharedKeys(0);
+
+void JSON::InternKeys(JSON_KEYS* Keys){
+  SharedKeys = Keys;
+}
+//------------------------------------------------------------------------------
+
+void JSON::NewKey(STRING* Key, const char* Name, size_t Length){
+  // Short keys are stored in the node anyway
+  if(Length >= STRING::LocalSize){
+    JSON_KEYS* Keys = SharedKeys.load(std::memory_order_acquire);
+    if(Keys){
+      const char* Interned = Keys->Intern(Name, Length);
+      if(Interned){
+        Key->View(Interned, Length);
+        return;
+      }
+    }
+  }
+  Key->Assign(Name, Length, Arena);
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, JSON& Value){
+  if(Type != typeObject) SetType(typeObject);
+
+  JSON* json = operator[](Name);
+  if(json) return json->AddOrUpdate(Value);
+
+  STRING Key;
+  NewKey(&Key, Name, strlen(Name));
+
+  JSON* Object = NewNode();
+  Object->operator=(Value);
+  Objects.emplace(std::move(Key), Object);
+
+  return Object;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, JSON&& Value){
+  if(Type != typeObject) SetType(typeObject);
+
+  JSON* json = operator[](Name);
+  if(json) return json->AddOrUpdate(std::move(Value));
+
+  STRING Key;
+  NewKey(&Key, Name, strlen(Name));
+
+  JSON* Object = NewNode();
+  Object->operator=(std::move(Value));
+  Objects.emplace(std::move(Key), Object);
+
+  return Object;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, const char* Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, int Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, unsigned Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, int64_t Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, uint64_t Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, double Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name, bool Value){
+  return AddOrUpdate(Name, JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddOrUpdate(const char* Name){
+  JSON* json = operator[](Name);
+  if(json)   return json;
+  JSON null; return AddOrUpdate(Name, null);
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::operator[] (const char* Name){
+  if(Type != typeObject) return 0;
+  Materialise();
+
+  auto Object = Objects.find(Name);
+  if(Object == Objects.end()) return 0;
+  return Object->second;
+}
+//------------------------------------------------------------------------------
+
+const JSON* JSON::operator[] (const char* Name) const{
+  if(Type != typeObject || Lazy) return 0;
+
+  auto Object = Objects.find(Name);
+  if(Object == Objects.end()) return 0;
+  return Object->second;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::AddMember(const char* Name, size_t Length, bool View){
+  if(Type != typeObject) SetType(typeObject);
+  Touch();
+
+  auto Object = Objects.find(Name, Length);
+  if(Object != Objects.end()){
+    Object->second->Reset(); // Later duplicates replace earlier ones
+    return Object->second;
+  }
+  STRING Key;
+  if(View) Key.View(Name, Length);
+  else     NewKey (&Key, Name, Length);
+
+  JSON* Node = NewNode();
+  Objects.emplace(std::move(Key), Node);
+
+  return Node;
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(JSON& Value){
+  JSON* Item = NewNode();
+  Item->operator=(Value);
+  AppendItem(Item);
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(JSON&& Value){
+  JSON* Item = NewNode();
+  Item->operator=(std::move(Value));
+  AppendItem(Item);
+}
+//------------------------------------------------------------------------------
+
+void JSON::AppendItem(JSON* Item){
+  // Any existing value becomes the first item in the array
+  if(Type == typeArray){
+    Materialise();
+    Touch();
+  }else{
+    JSON* First = 0;
+    if(Type != typeNull){
+      First = NewNode();
+      First->operator=(std::move(*this));
+    }
+    SetType(typeArray);
+    if(First) Items.push_back(First);
+  }
+  Items.push_back(Item);
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(const char* Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(int Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(unsigned Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(int64_t Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(uint64_t Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(double Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+void JSON::Append(bool Value){
+  Append(JSON(Value));
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::operator[] (int Index){
+  if(Type != typeArray) return 0;
+  Materialise();
+  if(Index < 0 || (size_t)Index >= Items.size()) return 0;
+  return Items[Index];
+}
+//------------------------------------------------------------------------------
+
+const JSON* JSON::operator[] (int Index) const{
+  if(Type != typeArray || Lazy) return 0;
+  if(Index < 0 || (size_t)Index >= Items.size()) return 0;
+  return Items[Index];
+}
+//------------------------------------------------------------------------------
+
+// Vectorised scanning of long runs.  Only whole blocks inside the input are
+// loaded, so that the buffer needs no padding; the remainder is scanned one
+// byte at a time, which is also the fallback on other architectures.
+#if defined(__AVX2__)
+  #define SIMD_WIDTH 32
+  typedef __m256i VECTOR;
+  #define SimdLoad(Data)       _mm256_loadu_si256((const __m256i*)(Data))
+  #define SimdSplat(Char)      _mm256_set1_epi8(Char)
+  #define SimdEqual(A, B)      _mm256_cmpeq_epi8(A, B)
+  #define SimdOr(A, B)         _mm256_or_si256(A, B)
+  #define SimdMax(A, B)        _mm256_max_epu8(A, B)
+  #define SimdMask(A) (uint32_t)_mm256_movemask_epi8(A)
+#elif defined(__SSE2__) || defined(_M_X64)
+  #define SIMD_WIDTH 16
+  typedef __m128i VECTOR;
+  #define SimdLoad(Data)       _mm_loadu_si128((const __m128i*)(Data))
+  #define SimdSplat(Char)      _mm_set1_epi8(Char)
+  #define SimdEqual(A, B)      _mm_cmpeq_epi8(A, B)
+  #define SimdOr(A, B)         _mm_or_si128(A, B)
+  #define SimdMax(A, B)        _mm_max_epu8(A, B)
+  #define SimdMask(A) (uint32_t)_mm_movemask_epi8(A)
+#endif
+
+#ifdef SIMD_WIDTH
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    static inline unsigned FirstBit(uint32_t Mask){
+      unsigned long Index;
+      _BitScanForward(&Index, Mask);
+      return Index;
+    }
+    #define CountBits(Mask) __popcnt(Mask)
+  #else
+    #define FirstBit(Mask)  __builtin_ctz(Mask)
+    #define CountBits(Mask) __builtin_popcount(Mask)
+  #endif
+#endif
+//------------------------------------------------------------------------------
+
+// A vertical tab is only white space in JSON-5
+template<bool VTab> static inline bool IsSpace(char Char){
+  return Char == ' ' || Char == '\n' || Char == '\r' || Char == '\t' || (VTab && Char == '\v');
+}
+//------------------------------------------------------------------------------
+
+// Returns the length of the leading whitespace, and counts the new-lines in it
+template<bool VTab> static size_t ScanSpace(const char* Data, size_t Size, size_t* Lines){
+  size_t n = 0;
+
+  // Most gaps between tokens are only a byte or two: not worth a vector
+  for(; n < Size && n < 2; n++){
+    if(!IsSpace<VTab>(Data[n])) return n;
+    if(Data[n] == '\n') (*Lines)++;
+  }
+
+  #ifdef SIMD_WIDTH
+    const VECTOR Space    = SimdSplat(' ' );
+    const VECTOR Tab      = SimdSplat('\t');
+    const VECTOR NewLine  = SimdSplat('\n');
+    const VECTOR Return   = SimdSplat('\r');
+    const VECTOR Vertical = SimdSplat(VTab ? '\v' : ' ');
+
+    for(; n + SIMD_WIDTH <= Size; n += SIMD_WIDTH){
+      VECTOR   Block  = SimdLoad(Data + n);
+      uint32_t Breaks = SimdMask(SimdEqual(Block, NewLine));
+      uint32_t Blank  = SimdMask(SimdOr(
+        SimdOr(SimdEqual(Block, Space ), SimdEqual(Block, Tab     )),
+        SimdOr(SimdEqual(Block, Return), SimdEqual(Block, Vertical))
+      )) | Breaks;
+
+      uint32_t Other = ~Blank;
+      #if SIMD_WIDTH < 32
+        Other &= (1u << SIMD_WIDTH) - 1;
+      #endif
+      if(Other){
+        unsigned Length = FirstBit(Other);
+        *Lines += CountBits(Breaks & ((1u << Length) - 1));
+        return n + Length;
+      }
+      *Lines += CountBits(Breaks);
+    }
+  #endif
+
+  for(; n < Size; n++){
+    if(!IsSpace<VTab>(Data[n])) break;
+    if(Data[n] == '\n') (*Lines)++;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+
+// Returns the length of the leading string content that needs no attention:
+// up to the closing quote, an escape sequence, an illegal control character
+// or the first byte that is not ASCII (which must be validated as UTF-8).
+// RFC 8259 forbids every control character; JSON-5 only line breaks.
+template<bool Controls> static size_t ScanString(const char* Data, size_t Size, char Quote){
+  size_t n = 0;
+
+  #ifdef SIMD_WIDTH
+    const VECTOR End     = SimdSplat(Quote);
+    const VECTOR Escape  = SimdSplat('\\');
+    const VECTOR NewLine = SimdSplat('\n');
+    const VECTOR Return  = SimdSplat('\r');
+    const VECTOR Control = SimdSplat(0x1F);
+
+    for(; n + SIMD_WIDTH <= Size; n += SIMD_WIDTH){
+      VECTOR Block = SimdLoad(Data + n);
+      VECTOR Illegal;
+      if(Controls) Illegal = SimdOr(SimdEqual(Block, NewLine), SimdEqual(Block, Return));
+      else         Illegal = SimdEqual(SimdMax(Block, Control), Control); // Below 0x20
+      // The top bit of every byte is already the "not ASCII" flag
+      uint32_t Mask = SimdMask(SimdOr(
+        SimdOr(SimdEqual(Block, End), SimdEqual(Block, Escape)),
+        SimdOr(Illegal, Block)
+      ));
+      if(Mask) return n + FirstBit(Mask);
+    }
+  #endif
+
+  for(; n < Size; n++){
+    byte Char = (byte)Data[n];
+    if(Char == (byte)Quote || Char == '\\' || (Char & 0x80)) break;
+    if(Controls ? (Char == '\n' || Char == '\r') : Char < 0x20) break;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+
+// Returns the length of the leading run of well-formed multi-byte UTF-8
+// sequences (RFC 3629: no overlong forms, surrogates or values beyond
+// U+10FFFF), which is 0 if the first one is not
+static size_t ScanUTF8(const char* Data, size_t Size){
+  const byte* Bytes = (const byte*)Data;
+  size_t      n     = 0;
+
+  while(n < Size && Bytes[n] >= 0x80){
+    byte Lead = Bytes[n];
+    byte Low  = 0x80; // Range of the second byte
+    byte High = 0xBF;
+    int  Length;
+
+    if     (Lead <  0xC2) break;
+    else if(Lead <  0xE0) Length = 2;
+    else if(Lead <  0xF0){
+      Length = 3;
+      if(Lead == 0xE0) Low  = 0xA0;
+      if(Lead == 0xED) High = 0x9F;
+    }else if(Lead < 0xF5){
+      Length = 4;
+      if(Lead == 0xF0) Low  = 0x90;
+      if(Lead == 0xF4) High = 0x8F;
+    }else break;
+
+    if(n + Length > Size || Bytes[n+1] < Low || Bytes[n+1] > High) break;
+    int j = 2;
+    for(; j < Length; j++){
+      if((Bytes[n+j] & 0xC0) != 0x80) break;
+    }
+    if(j < Length) break;
+    n += Length;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+
+// Returns the length of the leading text that cannot start or end a nested
+// value, and counts the new-lines in it
+static size_t ScanStructure(const char* Data, size_t Size, size_t* Lines){
+  size_t n = 0;
+
+  #ifdef SIMD_WIDTH
+    const VECTOR NewLine = SimdSplat('\n');
+    const VECTOR Open    = SimdSplat('{' );
+    const VECTOR Close   = SimdSplat('}' );
+    const VECTOR Start   = SimdSplat('[' );
+    const VECTOR End     = SimdSplat(']' );
+    const VECTOR Double  = SimdSplat('"' );
+    const VECTOR Single  = SimdSplat('\'');
+    const VECTOR Slash   = SimdSplat('/' );
+
+    for(; n + SIMD_WIDTH <= Size; n += SIMD_WIDTH){
+      VECTOR   Block  = SimdLoad(Data + n);
+      uint32_t Breaks = SimdMask(SimdEqual(Block, NewLine));
+      uint32_t Mask   = SimdMask(SimdOr(
+        SimdOr(
+          SimdOr(SimdEqual(Block, Open ), SimdEqual(Block, Close)),
+          SimdOr(SimdEqual(Block, Start), SimdEqual(Block, End  ))
+        ),
+        SimdOr(
+          SimdOr(SimdEqual(Block, Double), SimdEqual(Block, Single)),
+          SimdEqual(Block, Slash)
+        )
+      ));
+      if(Mask){
+        unsigned Length = FirstBit(Mask);
+        *Lines += CountBits(Breaks & ((1u << Length) - 1));
+        return n + Length;
+      }
+      *Lines += CountBits(Breaks);
+    }
+  #endif
+
+  for(; n < Size; n++){
+    char Char = Data[n];
+    if(Char == '{' || Char == '}' || Char == '[' || Char == ']' ||
+       Char == '"' || Char == '\'' || Char == '/') break;
+    if(Char == '\n') (*Lines)++;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+
+// Returns the length of the leading plain ASCII identifier characters
+static size_t ScanIdentifier(const char* Data, size_t Size){
+  size_t n = 0;
+  for(; n < Size; n++){
+    char Char = Data[n];
+    if(('a' <= Char && Char <= 'z') || ('A' <= Char && Char <= 'Z') ||
+       ('0' <= Char && Char <= '9') || Char == '_' || Char == '$') continue;
+    break;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+
+JSON_READER::JSON_READER(){
+  Handler    = 0;
+  ReadBuffer = 0;
+  ReadInSitu = 0;
+  ReadLine   = 0;
+  ReadSize   = 0;
+  ReadIndex  = 0;
+  Stopped    = false;
+  Features   = JSON5;
+}
+//------------------------------------------------------------------------------
+
+void JSON_READER::SetFeatures(unsigned Features){
+  this->Features = Features & JSON5;
+}
+//------------------------------------------------------------------------------
+
+unsigned JSON_READER::GetFeatures() const{
+  return Features;
+}
+//------------------------------------------------------------------------------
+
+void JSON_READER::ReadError(const char* Message){
+  static std::atomic<bool> FirstError(true); // Readers can run concurrently
+  if(Stopped) return; // Not an error: the handler asked to stop
+  if(FirstError.exchange(false)){
+    error("JSON error on line %llu:\n  %s", (unsigned long long)ReadLine, Message);
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON_READER::ReadLineComment(){
+  ReadIndex += 2;
+  while(ReadIndex < ReadSize){
+    switch(ReadBuffer[ReadIndex]){
+      case '\n':
+        ReadLine++;
+        ReadIndex++;
+        if(ReadBuffer[ReadIndex] == '\r') ReadIndex++;
+        return;
+
+      case '\r':
+        ReadLine++;
+        ReadIndex++;
+        if(ReadBuffer[ReadIndex] == '\n') ReadIndex++;
+        return;
+
+      default:
+        ReadIndex++;
+        break;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON_READER::ReadBlockComment(){
+  ReadIndex += 2;
+  while(ReadIndex < ReadSize){
+    switch(ReadBuffer[ReadIndex]){
+      case '\n':
+        ReadLine++;
+        ReadIndex++;
+        if(ReadBuffer[ReadIndex] == '\r') ReadIndex++;
+        break;
+
+      case '\r':
+        ReadLine++;
+        ReadIndex++;
+        if(ReadBuffer[ReadIndex] == '\n') ReadIndex++;
+        break;
+
+      case '*':
+        ReadIndex++;
+        if(ReadBuffer[ReadIndex] == '/'){
+          ReadIndex++;
+          return;
+        }
+        break;
+
+      default:
+        ReadIndex++;
+        break;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+
+// Most calls find no whitespace at all, so that case is kept cheap
+template<unsigned F> inline void JSON_READER::ReadSpace(){
+  if(ReadIndex < ReadSize){
+    char Char = ReadBuffer[ReadIndex];
+    if(Char > ' ' && (Char != '/' || !Allows<F>(fComments))) return;
+  }
+  SkipSpace<F>();
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> void JSON_READER::SkipSpace(){
+  while(ReadIndex < ReadSize){
+    if(Allows<F>(fSpace)) ReadIndex += ScanSpace<true >(ReadBuffer + ReadIndex, ReadSize - ReadIndex, &ReadLine);
+    else                  ReadIndex += ScanSpace<false>(ReadBuffer + ReadIndex, ReadSize - ReadIndex, &ReadLine);
+    if(!Allows<F>(fComments)) return;
+    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != '/') return;
+
+    switch(ReadBuffer[ReadIndex+1]){
+      case '/':
+        ReadLineComment();
+        break;
+      case '*':
+        ReadBlockComment();
+        break;
+      default:
+        return;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadPlain(char Quote){
+  for(;;){
+    if(Allows<F>(fControls)) ReadIndex += ScanString<true >(ReadBuffer + ReadIndex, ReadSize - ReadIndex, Quote);
+    else                     ReadIndex += ScanString<false>(ReadBuffer + ReadIndex, ReadSize - ReadIndex, Quote);
+    if(ReadIndex >= ReadSize || !(ReadBuffer[ReadIndex] & 0x80)) return true;
+
+    size_t Length = ScanUTF8(ReadBuffer + ReadIndex, ReadSize - ReadIndex);
+    if(!Length){
+      ReadError("Invalid UTF-8 in string");
+      return false;
+    }
+    ReadIndex += Length;
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadCodeUnit(uint32_t* Result){
+  uint32_t Char = 0;
+
+  if(ReadBuffer[ReadIndex] != 'u') return false;
+
+  for(int n = 0; n < 4; n++){
+    ReadIndex++;
+    if(ReadIndex >= ReadSize) return false;
+
+    if      (ReadBuffer[ReadIndex] >= '0' && ReadBuffer[ReadIndex] <= '9'){
       Char = 0x10*Char + (ReadBuffer[ReadIndex] - '0');
     }else if(ReadBuffer[ReadIndex] >= 'a' && ReadBuffer[ReadIndex] <= 'f'){
       Char = 0x10*Char + (ReadBuffer[ReadIndex] - 'a' + 0xA);
@@ -416,523 +1298,3145 @@ bool JSON::ReadUnicodeSequence(std::string* String){
       return false;
     }
   }
-  *String += Char;
+  *Result = Char;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadUnicodeSequence(string* String){
+  uint32_t Char;
+  if(!ReadCodeUnit(&Char)) return false;
+
+  // A high surrogate followed by a low one encodes a single code point.
+  // Unpaired surrogates cannot be encoded in UTF-8, so they are replaced.
+  if(Char >= 0xD800 && Char <= 0xDBFF){
+    size_t Index = ReadIndex;
+    if(ReadIndex + 2 < ReadSize && ReadBuffer[ReadIndex+1] == '\\'){
+      uint32_t Low;
+      ReadIndex += 2;
+      if(ReadCodeUnit(&Low) && Low >= 0xDC00 && Low <= 0xDFFF){
+        *String += (uint32_t)(0x10000 + ((Char - 0xD800) << 10) + (Low - 0xDC00));
+        return true;
+      }
+      ReadIndex = Index;
+    }
+    Char = 0xFFFD;
+  }else if(Char >= 0xDC00 && Char <= 0xDFFF){
+    Char = 0xFFFD;
+  }
+  *String += Char;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadIdentifierStart(string* String){
+  if('A' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'Z'){
+    *String += ReadBuffer[ReadIndex++];
+    return true;
+  }
+  if('a' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'z'){
+    *String += ReadBuffer[ReadIndex++];
+    return true;
+  }
+  if(ReadBuffer[ReadIndex] == '$' || ReadBuffer[ReadIndex] == '_'){
+    *String += ReadBuffer[ReadIndex++];
+    return true;
+  }
+  // This is actually wrong, but works when the input is assumed valid
+  if(ReadBuffer[ReadIndex] & 0xC0){
+    *String += ReadBuffer[ReadIndex++];
+    while((ReadBuffer[ReadIndex] & 0xC0) == 0x80) *String += ReadBuffer[ReadIndex++];
+    return true;
+  }
+  if(ReadBuffer[ReadIndex] == '\\'){
+    ReadIndex++;
+    if(!ReadUnicodeSequence(String)){
+      ReadError("Incomplete Unicode escape sequence");
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadIdentifierPart(string* String){
+  if(ReadIdentifierStart(String)) return true;
+
+  if('0' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= '9'){
+    *String += ReadBuffer[ReadIndex++];
+    return true;
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadIdentifier(const char** Value, size_t* Length){
+  if(ReadIndex >= ReadSize) return false;
+
+  string* String = &ReadScratch;
+  String->clear();
+
+  if(!ReadIdentifierStart(String)) return false;
+
+  do{
+    size_t Run = ScanIdentifier(ReadBuffer + ReadIndex, ReadSize - ReadIndex);
+    String->append(ReadBuffer + ReadIndex, Run);
+    ReadIndex += Run;
+  }while(ReadIdentifierPart(String));
+
+  *Value  = String->data();
+  *Length = String->size();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadString(const char** Value, size_t* Length){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  char Quote = ReadBuffer[ReadIndex];
+  if(Quote != '"' && (Quote != '\'' || !Allows<F>(fQuotes))) return false;
+  ReadIndex++;
+
+  // Most strings contain no escape sequences, in which case the value is
+  // simply the source text, without any decoding
+  size_t Start = ReadIndex;
+  if(!ReadPlain<F>(Quote)) return false;
+  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == Quote){
+    *Value  = ReadBuffer + Start;
+    *Length = ReadIndex - Start;
+    if(ReadInSitu) ReadInSitu[ReadIndex] = 0;
+    ReadIndex++;
+    return true;
+  }
+
+  string* String = &ReadScratch;
+  String->assign(ReadBuffer + Start, ReadIndex - Start);
+
+  char Escape;
+  while(ReadIndex < ReadSize){
+    size_t Run = ReadIndex;
+    if(!ReadPlain<F>(Quote)) return false;
+    String->append(ReadBuffer + Run, ReadIndex - Run);
+    if(ReadIndex >= ReadSize) break;
+
+    switch(ReadBuffer[ReadIndex]){
+      case '\\':
+        ReadIndex++;
+        if(ReadIndex >= ReadSize){
+          ReadError("Incomplete escape sequence");
+          return false;
+        }
+        Escape = ReadBuffer[ReadIndex];
+        if(!Allows<F>(fQuotes) && (Escape == '\'' || Escape == '\n' || Escape == '\r')){
+          Escape = 0; // Unrecognised
+        }
+        switch(Escape){
+          case '"' : *String += '"' ; break;
+          case '\'': *String += '\''; break;
+          case '\\': *String += '\\'; break;
+          case '/' : *String += '/' ; break;
+          case 'b' : *String += '\b'; break;
+          case 'f' : *String += '\f'; break;
+          case 'n' : *String += '\n'; break;
+          case 'r' : *String += '\r'; break;
+          case 't' : *String += '\t'; break;
+          case 'u' :
+            if(!ReadUnicodeSequence(String)){
+              ReadError("Incomplete Unicode escape sequence");
+              return false;
+            }
+            break;
+          case '\n':
+            ReadLine++;
+            if(ReadBuffer[ReadIndex+1] == '\r') ReadIndex++;
+            break;
+          case '\r':
+            ReadLine++;
+            if(ReadBuffer[ReadIndex+1] == '\n') ReadIndex++;
+            break;
+
+          default:
+            ReadError("Unrecognised escape sequence");
+            return false;
+        }
+        break;
+
+      default:
+        if(ReadBuffer[ReadIndex] != Quote){
+          ReadError("Unexpected control character in string");
+          return false;
+        }
+        // The closing quote
+        ReadIndex++;
+        if(ReadInSitu){
+          // The decoded string is never longer than its source
+          memcpy(ReadInSitu + Start, String->data(), String->size());
+          ReadInSitu[Start + String->size()] = 0;
+          *Value = ReadBuffer + Start;
+        }else{
+          *Value = String->data();
+        }
+        *Length = String->size();
+        return true;
+    }
+    ReadIndex++;
+  }
+  ReadError("Incomplete string");
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadHexadecimal(bool Sign){
+  uint64_t Result = 0;
+  double   Value  = 0; // Used once the digits no longer fit in 64 bits
+  bool     Exact  = true;
+  size_t   Start  = ReadIndex;
+
+  while(ReadIndex < ReadSize){
+    unsigned Digit;
+    char     Char = ReadBuffer[ReadIndex];
+    if     ('0' <= Char && Char <= '9') Digit = Char - '0';
+    else if('a' <= Char && Char <= 'f') Digit = Char - 'a' + 10;
+    else if('A' <= Char && Char <= 'F') Digit = Char - 'A' + 10;
+    else break;
+    ReadIndex++;
+
+    if(Exact && Result >> 60){
+      Exact = false;
+      Value = (double)Result;
+    }
+    if(Exact) Result = 16*Result + Digit;
+    else      Value  = 16.0*Value + Digit;
+  }
+  if(ReadIndex == Start){
+    ReadError("Hexadecimal digits expected");
+    return false;
+  }
+  if(!Exact) return Handler->Number(Sign ? -Value : Value) || Stop();
+
+  if(!Sign){
+    if(Result > INT64_MAX) return Handler->Unsigned(Result) || Stop();
+    return Handler->Integer((int64_t)Result) || Stop();
+  }
+  if(!Result) return Handler->Number(-0.0) || Stop();
+  if(Result <= (uint64_t)INT64_MAX + 1) return Handler->Integer((int64_t)(0 - Result)) || Stop();
+  return Handler->Number(-(double)Result) || Stop();
+}
+//------------------------------------------------------------------------------
+
+// Powers of 10 that are exact in a double
+static const double ExactPowers[] = {
+  1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 , 1e7 , 1e8 , 1e9 , 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadNumber(){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  if(Allows<F>(fNumbers) && (ReadBuffer[ReadIndex] < '0' || ReadBuffer[ReadIndex] > '9')){
+    if(ReadIndex+8 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "Infinity", 8)){
+      ReadIndex += 8;
+      return Handler->Number(1.0/0.0) || Stop();
+    }
+    if(ReadIndex+9 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "-Infinity", 9)){
+      ReadIndex += 9;
+      return Handler->Number(-1.0/0.0) || Stop();
+    }
+    if(ReadIndex+3 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "NaN", 3)){
+      ReadIndex += 3;
+      return Handler->Number(0.0/0.0) || Stop();
+    }
+  }
+
+  bool Sign         = false;
+  bool ExponentSign = false;
+
+  if(ReadBuffer[ReadIndex] == '-'){
+    Sign = true;
+    ReadIndex++;
+    if(ReadIndex >= ReadSize) return false;
+  }else if(Allows<F>(fNumbers) && ReadBuffer[ReadIndex] == '+'){
+    Sign = false;
+    ReadIndex++;
+    if(ReadIndex >= ReadSize) return false;
+  }
+
+  if((ReadBuffer[ReadIndex] <  '0' || ReadBuffer[ReadIndex] > '9') &&
+     (ReadBuffer[ReadIndex] != '.' || !Allows<F>(fNumbers))){
+    if(Sign) ReadError("Incomplete number");
+    return false;
+  }
+
+  if(Allows<F>(fNumbers) && ReadIndex+2 <= ReadSize && ReadBuffer[ReadIndex] == '0' &&
+     (ReadBuffer[ReadIndex+1] == 'x' || ReadBuffer[ReadIndex+1] == 'X')){
+    ReadIndex += 2;
+    return ReadHexadecimal(Sign);
+  }
+
+  // The significant digits are accumulated in an integer, as long as they
+  // fit, and the position of the decimal point is kept in "Exponent"
+  size_t   Start     = ReadIndex;
+  uint64_t Mantissa  = 0;
+  int64_t  Exponent  = 0;
+  int64_t  Decimals  = 0;     // Digits after the decimal point
+  int64_t  Power     = 0;     // Explicit exponent
+  bool     Integral  = true;  // No fraction or exponent
+
+  if(ReadBuffer[ReadIndex] == '0'){
+    ReadIndex++;
+    if(ReadIndex < ReadSize &&
+       ReadBuffer[ReadIndex] >= '0' && ReadBuffer[ReadIndex] <= '9'){
+      ReadError("Invalid number format");
+      return false;
+    }
+  }
+
+  const uint64_t Limit = UINT64_MAX / 10;
+
+  while(ReadIndex < ReadSize){
+    unsigned Digit = ReadBuffer[ReadIndex] - '0';
+    if(Digit > 9) break;
+    if(Mantissa < Limit || (Mantissa == Limit && Digit <= UINT64_MAX % 10)){
+      Mantissa = 10*Mantissa + Digit;
+    }else{
+      Exponent++; // Only the first 19 or 20 digits are kept
+    }
+    ReadIndex++;
+  }
+
+  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '.'){
+    Integral = false;
+    ReadIndex++;
+    while(ReadIndex < ReadSize){
+      unsigned Digit = ReadBuffer[ReadIndex] - '0';
+      if(Digit > 9) break;
+      if(Mantissa < Limit){
+        Mantissa = 10*Mantissa + Digit;
+        Exponent--;
+      }
+      Decimals++;
+      ReadIndex++;
+    }
+    if(!Decimals && !Allows<F>(fNumbers)){
+      ReadError("Invalid number format");
+      return false;
+    }
+  }
+
+  if(ReadIndex < ReadSize &&
+     (ReadBuffer[ReadIndex] == 'e' || ReadBuffer[ReadIndex] == 'E')){
+    Integral = false;
+    ReadIndex++;
+    if(ReadIndex >= ReadSize){
+      ReadError("Incomplete number");
+      return false;
+    }
+    if(ReadBuffer[ReadIndex] == '-' || ReadBuffer[ReadIndex] == '+'){
+      ExponentSign = (ReadBuffer[ReadIndex] == '-');
+      ReadIndex++;
+    }
+    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] < '0' || ReadBuffer[ReadIndex] > '9'){
+      ReadError("Exponent expected");
+      return false;
+    }
+    while(ReadIndex < ReadSize){
+      unsigned Digit = ReadBuffer[ReadIndex] - '0';
+      if(Digit > 9) break;
+      if(Power < 1000000) Power = 10*Power + Digit; // Saturates
+      ReadIndex++;
+    }
+    if(ExponentSign) Power = -Power;
+    Exponent += Power;
+  }
+  size_t End = ReadIndex;
+
+  if(Integral && !Exponent){
+    if(!Sign){
+      if(Mantissa > INT64_MAX) return Handler->Unsigned(Mantissa) || Stop();
+      return Handler->Integer((int64_t)Mantissa) || Stop();
+    }
+    if(Mantissa && Mantissa <= (uint64_t)INT64_MAX + 1){
+      return Handler->Integer((int64_t)(0 - Mantissa)) || Stop();
+    }
+  }
+
+  double Result;
+
+  // When both the mantissa and the power of 10 are exact doubles, a single
+  // multiplication or division is correctly rounded (Clinger's fast path)
+  if(Mantissa <= (1ull << 53) && -22 <= Exponent && Exponent <= 22){
+    Result = (double)Mantissa;
+    if(Exponent < 0) Result /= ExactPowers[-Exponent];
+    else             Result *= ExactPowers[ Exponent];
+
+  }else if(!Mantissa){
+    Result = 0;
+
+  }else{
+    // Otherwise all the digits are handed to strtod, which is correctly
+    // rounded.  It is given an integer mantissa, so that the result does not
+    // depend on the decimal point of the current locale.
+    string* Digits = &ReadScratch;
+    Digits->clear();
+    for(size_t n = Start; n < End; n++){
+      char Char = ReadBuffer[n];
+      if(Char == 'e' || Char == 'E') break;
+      if(Char != '.') *Digits += Char;
+    }
+    char s[32];
+    sprintf(s, "e%lld", (long long)(Power - Decimals));
+    *Digits += s;
+    Result = strtod(Digits->c_str(), 0);
+  }
+  return Handler->Number(Sign ? -Result : Result) || Stop();
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadObject(){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  if(ReadBuffer[ReadIndex] != '{') return false;
+  ReadIndex++;
+
+  if(!Handler->StartObject()) return Stop();
+
+  const char* Name;
+  size_t      Length;
+
+  ReadSpace<F>();
+  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
+    ReadIndex++;
+    return Handler->EndObject() || Stop();
+  }
+
+  while(ReadIndex < ReadSize){
+    if(!ReadString<F>(&Name, &Length)){
+      if(!Allows<F>(fIdentifiers) || !ReadIdentifier(&Name, &Length)){
+        ReadError("String or Identifier expected");
+        return false;
+      }
+    }
+    if(!Handler->Key(Name, Length)) return Stop();
+
+    ReadSpace<F>();
+    if(ReadBuffer[ReadIndex] != ':'){
+      ReadError("\":\" expected");
+      return false;
+    }
+    ReadIndex++;
+    if(ReadIndex >= ReadSize){
+      ReadError("Incomplete object");
+      return false;
+    }
+    if(!ReadValue<F>()){
+      ReadError("Value expected");
+      return false;
+    }
+    ReadSpace<F>();
+    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
+      ReadIndex++;
+      return Handler->EndObject() || Stop();
+    }
+    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ','){
+      ReadError("\",\" expected");
+      return false;
+    }
+    ReadIndex++;
+    ReadSpace<F>();
+    if(Allows<F>(fTrailing) && ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
+      ReadIndex++;
+      return Handler->EndObject() || Stop();
+    }
+  }
+  ReadError("Incomplete object");
+  return false;
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadArray(){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  if(ReadBuffer[ReadIndex] != '[') return false;
+  ReadIndex++;
+
+  if(!Handler->StartArray()) return Stop();
+
+  ReadSpace<F>();
+  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
+    ReadIndex++;
+    return Handler->EndArray() || Stop();
+  }
+
+  while(ReadIndex < ReadSize){
+    if(!ReadValue<F>()){
+      ReadError("Value expected");
+      return false;
+    }
+    ReadSpace<F>();
+    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
+      ReadIndex++;
+      return Handler->EndArray() || Stop();
+    }
+    ReadSpace<F>();
+    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ','){
+      ReadError("\",\" expected");
+      return false;
+    }
+    ReadIndex++;
+    ReadSpace<F>();
+    if(Allows<F>(fTrailing) && ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
+      ReadIndex++;
+      return Handler->EndArray() || Stop();
+    }
+  }
+  ReadError("Incomplete object");
+  return false;
+}
+//------------------------------------------------------------------------------
+
+// Finds the end of an object or array by matching the brackets, skipping
+// strings and comments, but without validating anything else
+bool JSON_READER::ReadDeferred(){
+  size_t Start = ReadIndex;
+  size_t Depth = 0;
+
+  while(ReadIndex < ReadSize){
+    ReadIndex += ScanStructure(ReadBuffer + ReadIndex, ReadSize - ReadIndex, &ReadLine);
+    if(ReadIndex >= ReadSize) break;
+
+    char Char = ReadBuffer[ReadIndex];
+    switch(Char){
+      case '{':
+      case '[':
+        Depth++;
+        ReadIndex++;
+        break;
+
+      case '}':
+      case ']':
+        ReadIndex++;
+        if(!--Depth){
+          return Handler->Deferred(ReadBuffer + Start, ReadIndex - Start) || Stop();
+        }
+        break;
+
+      case '/':
+        Char = ReadIndex+1 < ReadSize ? ReadBuffer[ReadIndex+1] : 0;
+        if     (Char == '/') ReadLineComment ();
+        else if(Char == '*') ReadBlockComment();
+        else                 ReadIndex++;
+        break;
+
+      default: // A string
+        ReadIndex++;
+        while(ReadIndex < ReadSize){
+          ReadIndex += ScanString<true>(ReadBuffer + ReadIndex, ReadSize - ReadIndex, Char);
+          if(ReadIndex >= ReadSize) break;
+
+          char Next = ReadBuffer[ReadIndex++];
+          if(Next == Char) break;
+          if(Next == '\\'){
+            if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '\n') ReadLine++;
+            ReadIndex++;
+          }else if(Next == '\n'){
+            ReadLine++;
+          }
+        }
+        break;
+    }
+  }
+  ReadError("Incomplete object");
+  return false;
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadValue(){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  const char* String;
+  size_t      Length;
+
+  // The first character determines the type, so that each value is only
+  // handed to the one reader that can accept it
+  switch(ReadBuffer[ReadIndex]){
+    case '"':
+    case '\'':
+      if(ReadString<F>(&String, &Length)) return Handler->String(String, Length) || Stop();
+      return false;
+
+    case '{':
+      if(Handler->Defer()) return ReadDeferred();
+      return ReadObject<F>();
+
+    case '[':
+      if(Handler->Defer()) return ReadDeferred();
+      return ReadArray<F>();
+
+    case 't':
+      if(ReadIndex+4 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "true", 4)){
+        ReadIndex += 4;
+        return Handler->Bool(true) || Stop();
+      }
+      return false;
+
+    case 'f':
+      if(ReadIndex+5 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "false", 5)){
+        ReadIndex += 5;
+        return Handler->Bool(false) || Stop();
+      }
+      return false;
+
+    case 'n':
+      if(ReadIndex+4 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "null", 4)){
+        ReadIndex += 4;
+        return Handler->Null() || Stop();
+      }
+      return false;
+
+    default:
+      return ReadNumber<F>();
+  }
+}
+//------------------------------------------------------------------------------
+
+template<unsigned F> bool JSON_READER::ReadOutline(){
+  ReadSpace<F>();
+  if(ReadIndex >= ReadSize) return false;
+
+  char Close;
+  switch(ReadBuffer[ReadIndex]){
+    case '{':
+      if(!Handler->StartObject()) return Stop();
+      Close = '}';
+      break;
+
+    case '[':
+      if(!Handler->StartArray()) return Stop();
+      Close = ']';
+      break;
+
+    default:
+      ReadError("Object or array expected");
+      return false;
+  }
+  ReadIndex++;
+
+  const char* Name;
+  size_t      Length;
+
+  ReadSpace<F>();
+  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] != Close){
+    while(ReadIndex < ReadSize){
+      if(Close == '}'){
+        if(!ReadString<F>(&Name, &Length)){
+          if(!Allows<F>(fIdentifiers) || !ReadIdentifier(&Name, &Length)){
+            ReadError("String or Identifier expected");
+            return false;
+          }
+        }
+        if(!Handler->Key(Name, Length)) return Stop();
+
+        ReadSpace<F>();
+        if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ':'){
+          ReadError("\":\" expected");
+          return false;
+        }
+        ReadIndex++;
+        ReadSpace<F>();
+      }
+      if(ReadIndex >= ReadSize) break;
+
+      // Scalars are parsed, to find their end
+      size_t Start = ReadIndex;
+      char   Char  = ReadBuffer[ReadIndex];
+      if(Char == '{' || Char == '['){
+        if(!ReadDeferred()) return false;
+      }else{
+        if(!ReadValue<F>()){
+          ReadError("Value expected");
+          return false;
+        }
+        if(!Handler->Deferred(ReadBuffer + Start, ReadIndex - Start)) return Stop();
+      }
+
+      ReadSpace<F>();
+      if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == Close) break;
+      if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ','){
+        ReadError("\",\" expected");
+        return false;
+      }
+      ReadIndex++;
+      ReadSpace<F>();
+      if(Allows<F>(fTrailing) && ReadIndex < ReadSize && ReadBuffer[ReadIndex] == Close) break;
+    }
+  }
+  if(ReadIndex >= ReadSize){
+    ReadError("Incomplete object");
+    return false;
+  }
+  ReadIndex++;
+
+  if(Close == '}') return Handler->EndObject() || Stop();
+  else             return Handler->EndArray () || Stop();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::Stop(){
+  Stopped = true;
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::Parse(JSON_HANDLER* Handler, const char* json, size_t Length){
+  return Parse(Handler, json, 0, Length);
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ParseInSitu(JSON_HANDLER* Handler, char* json, size_t Length){
+  return Parse(Handler, json, json, Length);
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::Parse(
+  JSON_HANDLER* Handler,
+  const char*   json,
+  char*         InSitu,
+  size_t        Length
+){
+  if(Length) ReadSize = Length;
+  else       ReadSize = strlen(json);
+
+  this->Handler = Handler;
+
+  ReadLine   = 1;
+  ReadIndex  = 0;
+  ReadBuffer = json;
+  ReadInSitu = InSitu;
+  Stopped    = false;
+
+  bool Result;
+  switch(Features){
+    case Strict: Result = ReadValue<Strict >(); break;
+    case JSON5 : Result = ReadValue<JSON5  >(); break;
+    default    : Result = ReadValue<Dynamic>(); break;
+  }
+  if(Result && !(Features & fTail) && !AtEnd()){
+    ReadError("Unexpected text after the value");
+    Result = false;
+  }
+  if(!Result){
+    ReadError("Cannot parse JSON file");
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::IsInSitu(const char* String){
+  return ReadInSitu && String >= ReadInSitu && String < ReadInSitu + ReadSize;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::AtEnd(){
+  switch(Features){
+    case Strict: ReadSpace<Strict >(); break;
+    case JSON5 : ReadSpace<JSON5  >(); break;
+    default    : ReadSpace<Dynamic>(); break;
+  }
+  return ReadIndex >= ReadSize;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::Outline(JSON_HANDLER* Handler, const char* json, size_t Length){
+  if(Length) ReadSize = Length;
+  else       ReadSize = strlen(json);
+
+  this->Handler = Handler;
+
+  ReadLine   = 1;
+  ReadIndex  = 0;
+  ReadBuffer = json;
+  ReadInSitu = 0;
+  Stopped    = false;
+
+  bool Result;
+  switch(Features){
+    case Strict: Result = ReadOutline<Strict >(); break;
+    case JSON5 : Result = ReadOutline<JSON5  >(); break;
+    default    : Result = ReadOutline<Dynamic>(); break;
+  }
+  if(Result && !(Features & fTail) && !AtEnd()){
+    ReadError("Unexpected text after the value");
+    Result = false;
+  }
+  if(!Result){
+    ReadError("Cannot outline JSON file");
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_READER::ReadToken(
+  JSON_HANDLER* Handler,
+  const char*   Token,
+  size_t        Length,
+  size_t        Line,
+  bool          Key
+){
+  this->Handler = Handler;
+
+  ReadLine   = Line;
+  ReadIndex  = 0;
+  ReadSize   = Length;
+  ReadBuffer = Token;
+  ReadInSitu = 0;
+  Stopped    = false;
+
+  if(Key){
+    const char* Name;
+    size_t      NameLength;
+    if(
+      !ReadString<Dynamic>(&Name, &NameLength) &&
+      (!Allows<Dynamic>(fIdentifiers) || !ReadIdentifier(&Name, &NameLength))
+    ) return false;
+    if(ReadIndex < ReadSize) return false;
+    return Handler->Key(Name, NameLength) || Stop();
+  }
+  if(!ReadValue<Dynamic>()) return false;
+  return ReadIndex == ReadSize;
+}
+//------------------------------------------------------------------------------
+
+JSON::BUILDER::BUILDER(JSON* Root, JSON_READER* Reader, bool Lazy, bool Pack){
+  this->Root   = Root;
+  this->Reader = Reader;
+  this->Lazy   = Lazy;
+  this->Pack   = Pack;
+  Member       = 0;
+  Packing      = 0;
+}
+//------------------------------------------------------------------------------
+
+JSON* JSON::BUILDER::NewValue(){
+  if(Packing) Unpack(); // Anything other than a number
+  if(Stack.empty()) return Root;
+
+  JSON* Parent = Stack.back();
+  if(Parent->Type == typeArray){
+    JSON* Item = Parent->NewNode();
+    Parent->Items.push_back(Item);
+    return Item;
+  }
+  return Member;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Null(){
+  NewValue()->Reset();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Bool(bool Value){
+  *NewValue() = Value;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+void JSON::BUILDER::Unpack(){
+  JSON* Node = Packing;
+  Packing    = 0;
+
+  for(size_t n = 0; n < Numbers.size(); n++){
+    JSON* Item = Node->NewNode();
+    if(Numbers[n].IsInteger) *Item = Numbers[n].Integer;
+    else                     *Item = Numbers[n].Value;
+    Node->Items.push_back(Item);
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Number(double Value){
+  if(Packing){
+    NUMBER Number = {Value, 0, false};
+    Numbers.push_back(Number);
+    return true;
+  }
+  *NewValue() = Value;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Integer(int64_t Value){
+  if(Packing){
+    NUMBER Number = {(double)Value, Value, true};
+    Numbers.push_back(Number);
+    return true;
+  }
+  *NewValue() = Value;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Unsigned(uint64_t Value){
+  *NewValue() = Value;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::String(const char* Value, size_t Length){
+  JSON* Node = NewValue();
+  Node->SetType(typeString);
+
+  if(Reader && Reader->IsInSitu(Value)) Node->String.View  (Value, Length);
+  else                                  Node->String.Assign(Value, Length, Node->Arena);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::StartObject(){
+  JSON* Node = NewValue();
+  Node->SetType(typeObject);
+  Stack.push_back(Node);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Key(const char* Name, size_t Length){
+  Member = Stack.back()->AddMember(Name, Length, Reader && Reader->IsInSitu(Name));
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::EndObject(){
+  Stack.pop_back();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::StartArray(){
+  JSON* Node = NewValue();
+  Node->SetType(typeArray);
+  Stack.push_back(Node);
+
+  if(Pack){
+    Packing = Node;
+    Numbers.clear();
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::EndArray(){
+  JSON* Node = Stack.back();
+  Stack.pop_back();
+
+  if(!Packing || Numbers.empty()){
+    Packing = 0;
+    return true;
+  }
+
+  // Integers are only packed as doubles when that is exact
+  const int64_t Exact    = (int64_t)1 << 53;
+  bool          Integers = true;
+  bool          Doubles  = true;
+  for(size_t n = 0; n < Numbers.size(); n++){
+    const NUMBER& Number = Numbers[n];
+    if(!Number.IsInteger) Integers = false;
+    else if(Number.Integer < -Exact || Number.Integer > Exact) Doubles = false;
+  }
+  if(!Integers && !Doubles){
+    Unpack();
+    return true;
+  }
+  Packing = 0;
+
+  size_t Size = Numbers.size() * 8;
+  SPAN*  Span;
+  if(Node->Arena){
+    Span       = (SPAN*)Node->Arena->Allocate(sizeof(SPAN));
+    Span->Data = (char*)Node->Arena->Allocate(Size, 8);
+  }else{
+    Span       = new SPAN;
+    Span->Data = (char*)malloc(Size);
+  }
+  Span->Length  = Numbers.size();
+  Span->Packing  = Integers ? pkInt64 : pkDouble;
+  Span->Pack     = false;
+  Span->Features = JSON_READER::JSON5;
+
+  for(size_t n = 0; n < Numbers.size(); n++){
+    if(Integers) ((int64_t*)Span->Data)[n] = Numbers[n].Integer;
+    else         ((double *)Span->Data)[n] = Numbers[n].Value;
+  }
+  Node->Lazy = Span;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Defer(){
+  return Lazy && !Stack.empty(); // The root itself is always parsed
+}
+//------------------------------------------------------------------------------
+
+bool JSON::BUILDER::Deferred(const char* Json, size_t Length){
+  JSON* Node = NewValue();
+  Node->SetType(*Json == '{' ? typeObject : typeArray);
+
+  // Lazy documents are always parsed in-situ, so the source is writable
+  SPAN* Span;
+  if(Node->Arena) Span = (SPAN*)Node->Arena->Allocate(sizeof(SPAN));
+  else            Span = new SPAN;
+  Span->Data     = (char*)Json;
+  Span->Length   = Length;
+  Span->Packing  = pkText;
+  Span->Pack     = Pack;
+  Span->Features = (uint8_t)Reader->GetFeatures();
+  Node->Lazy     = Span;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Materialise(){
+  if((Type != typeObject && Type != typeArray) || !Lazy) return true;
+
+  SPAN Span = *Lazy;
+  if(!Arena) delete Lazy;
+  Lazy = 0;
+
+  if(Span.Packing != pkText){
+    Items.reserve(Span.Length);
+    for(size_t n = 0; n < Span.Length; n++){
+      JSON* Item = NewNode();
+      if(Span.Packing == pkInt64) *Item = ((int64_t*)Span.Data)[n];
+      else                        *Item = ((double *)Span.Data)[n];
+      Items.push_back(Item);
+    }
+    if(!Arena) free(Span.Data);
+    return true;
+  }
+
+  // The nested values of this one are deferred in turn
+  JSON_READER Reader;
+  BUILDER     Builder(this, &Reader, true, Span.Pack);
+  Reader.SetFeatures(Span.Features);
+  if(!Reader.ParseInSitu(&Builder, Span.Data, Span.Length)){
+    Reset();
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+const int64_t* JSON::GetPackedInt64(size_t* Count) const{
+  if(Type != typeArray || !Lazy || Lazy->Packing != pkInt64) return 0;
+  *Count = Lazy->Length;
+  return (const int64_t*)Lazy->Data;
+}
+//------------------------------------------------------------------------------
+
+const double* JSON::GetPackedDouble(size_t* Count) const{
+  if(Type != typeArray || !Lazy || Lazy->Packing != pkDouble) return 0;
+  *Count = Lazy->Length;
+  return (const double*)Lazy->Data;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Parse(const char* json, size_t Length, unsigned Flags){
+  BeginParse(Flags);
+
+  // Lazy values refer to the buffer until they are parsed
+  if(Flags & pfLazy) Flags |= pfInSitu;
+
+  if(!(Flags & pfInSitu)) return ParseBuffer(json, 0, Length, Flags);
+
+  if(!Length) Length = strlen(json);
+
+  // Copy the input once, so that the strings can be decoded in place
+  char* Buffer;
+  if(Arena){
+    Buffer = Arena->Duplicate(json, Length);
+  }else{
+    Buffer = GetDocument()->Buffer = new char[Length+1];
+    memcpy(Buffer, json, Length);
+    Buffer[Length] = 0;
+  }
+  return ParseBuffer(Buffer, Buffer, Length, Flags);
+}
+//------------------------------------------------------------------------------
+
+bool JSON::ParseFile(const char* Filename, unsigned Flags){
+  FILE_WRAPPER File;
+  uint64_t     Size;
+
+  // The map is released on return: the document keeps copies of the
+  // strings, or, with "pfInSitu", Parse makes its own writable copy.
+  const char* Buffer = (const char*)File.Map(Filename, &Size);
+  if(!Buffer){
+    Clear();
+    error("Cannot map JSON file \"%s\"", Filename);
+    return false;
+  }
+  return Parse(Buffer, Size, Flags);
+}
+//------------------------------------------------------------------------------
+
+bool JSON::ParseInSitu(char* json, size_t Length, unsigned Flags){
+  BeginParse(Flags);
+  return ParseBuffer(json, json, Length, Flags);
+}
+//------------------------------------------------------------------------------
+
+void JSON::BeginParse(unsigned Flags){
+  Clear();
+
+  if((Flags & pfArena) && !Arena){
+    DOCUMENT* Document = GetDocument();
+    if(!Document->Arena) Document->Arena = new ARENA;
+    Arena = Document->Arena;
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON::ParseBuffer(const char* json, char* InSitu, size_t Length, unsigned Flags){
+  JSON_READER Reader;
+  BUILDER     Builder(this, &Reader, Flags & pfLazy, Flags & pfPacked);
+  if(Flags & pfStrict) Reader.SetFeatures(JSON_READER::Strict);
+
+  if(InSitu) return Reader.ParseInSitu(&Builder, InSitu, Length);
+  else       return Reader.Parse      (&Builder, json  , Length);
+}
+//------------------------------------------------------------------------------
+
+JSON_STREAM::JSON_STREAM(){
+  Handler = 0;
+  Builder = 0;
+  Begin((JSON_HANDLER*)0);
+}
+//------------------------------------------------------------------------------
+
+JSON_STREAM::~JSON_STREAM(){
+  if(Builder) delete Builder;
+}
+//------------------------------------------------------------------------------
+
+void JSON_STREAM::Begin(JSON_HANDLER* Handler, unsigned Features){
+  if(Builder) delete Builder;
+  Builder = 0;
+
+  this->Handler = Handler;
+  Reader.SetFeatures(Features);
+
+  State  = sSpace;
+  Expect = eValue;
+  Line   = 1;
+  Comma  = false;
+  Failed = false;
+  Stack.clear();
+  Carry.clear();
+}
+//------------------------------------------------------------------------------
+
+void JSON_STREAM::Begin(JSON* Document, unsigned Flags){
+  Document->BeginParse(Flags & ~JSON::pfInSitu);
+
+  Begin(
+    new JSON::BUILDER(Document, 0, false, Flags & JSON::pfPacked),
+    (Flags & JSON::pfStrict) ? JSON_READER::Strict : JSON_READER::JSON5
+  );
+  Builder = (JSON::BUILDER*)Handler;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::Error(const char* Message){
+  if(!Reader.Stopped){
+    Reader.ReadLine = Line;
+    Reader.ReadError(Message);
+  }
+  Failed = true;
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::Stop(){
+  Failed = true;
+  return false;
+}
+//------------------------------------------------------------------------------
+
+void JSON_STREAM::AfterValue(){
+  if(Stack.empty()) Expect = eDone;
+  else              Expect = eCommaOrEnd;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::Structural(char Char){
+  bool AfterComma = Comma;
+  Comma = false;
+
+  if(Expect == eDone) return Error("Unexpected text after the value");
+
+  switch(Char){
+    case '{':
+    case '[':
+      if(Expect != eValue && Expect != eValueOrEnd) return Error("Unexpected bracket");
+      if(Char == '{'){
+        if(!Handler->StartObject()) return Stop();
+        Expect = eKeyOrEnd;
+      }else{
+        if(!Handler->StartArray()) return Stop();
+        Expect = eValueOrEnd;
+      }
+      Stack.push_back(Char == '{');
+      return true;
+
+    case '}':
+      if((Expect != eKeyOrEnd && Expect != eCommaOrEnd) || !Stack.back()){
+        return Error("Unexpected \"}\"");
+      }
+      if(AfterComma && !(Reader.Features & JSON_READER::fTrailing)){
+        return Error("String or Identifier expected");
+      }
+      Stack.pop_back();
+      if(!Handler->EndObject()) return Stop();
+      AfterValue();
+      return true;
+
+    case ']':
+      if((Expect != eValueOrEnd && Expect != eCommaOrEnd) || Stack.back()){
+        return Error("Unexpected \"]\"");
+      }
+      if(AfterComma && !(Reader.Features & JSON_READER::fTrailing)){
+        return Error("Value expected");
+      }
+      Stack.pop_back();
+      if(!Handler->EndArray()) return Stop();
+      AfterValue();
+      return true;
+
+    case ':':
+      if(Expect != eColon) return Error("Unexpected \":\"");
+      Expect = eValue;
+      return true;
+
+    case ',':
+      if(Expect != eCommaOrEnd) return Error("Unexpected \",\"");
+      Expect = Stack.back() ? eKeyOrEnd : eValueOrEnd;
+      Comma  = true;
+      return true;
+
+    default:
+      return false;
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::Token(const char* Token, size_t Length){
+  Comma = false;
+
+  switch(Expect){
+    case eValue:
+    case eValueOrEnd:
+      if(!Reader.ReadToken(Handler, Token, Length, Line, false)) return Error("Value expected");
+      AfterValue();
+      return true;
+
+    case eKeyOrEnd:
+      if(!Reader.ReadToken(Handler, Token, Length, Line, true)) return Error("String or Identifier expected");
+      Expect = eColon;
+      return true;
+
+    case eColon:
+      return Error("\":\" expected");
+
+    case eDone:
+      return Error("Unexpected text after the value");
+
+    default:
+      return Error("\",\" expected");
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::Parse(const char* Chunk, size_t Length){
+  if(Failed) return false;
+
+  size_t n     = 0;
+  size_t Start = 0; // Start of the current token in this chunk
+
+  // Without fTail, whatever follows the value must still be white space
+  bool Tail = Reader.Features & JSON_READER::fTail;
+  while(n < Length && (Expect != eDone || !Tail)){
+    char Char = Chunk[n];
+
+    switch(State){
+      case sSpace:
+        switch(Char){
+          case '\v':
+            if(!(Reader.Features & JSON_READER::fSpace)) return Error("Unexpected vertical tab");
+            break;
+
+          case '\n': Line++;
+          case '\r':
+          case '\t':
+          case ' ' :
+            break;
+
+          case '/':
+            if(!(Reader.Features & JSON_READER::fComments)) return Error("Unexpected \"/\"");
+            State = sSlash;
+            break;
+
+          case '{': case '}':
+          case '[': case ']':
+          case ':': case ',':
+            if(!Structural(Char)) return false;
+            break;
+
+          case '"':
+          case '\'':
+            Quote = Char;
+            State = sString;
+            Start = n;
+            break;
+
+          default:
+            State = sWord;
+            Start = n;
+            break;
+        }
+        n++;
+        break;
+
+      case sSlash:
+        if     (Char == '/') State = sLineComment;
+        else if(Char == '*') State = sBlockComment;
+        else return Error("Unexpected \"/\"");
+        n++;
+        break;
+
+      case sLineComment:
+        if(Char == '\n' || Char == '\r'){
+          if(Char == '\n') Line++;
+          State = sSpace;
+        }
+        n++;
+        break;
+
+      case sBlockComment:
+        if     (Char == '*' ) State = sBlockStar;
+        else if(Char == '\n') Line++;
+        n++;
+        break;
+
+      case sBlockStar:
+        if     (Char == '/' ) State = sSpace;
+        else if(Char != '*' ) State = sBlockComment;
+        if     (Char == '\n') Line++;
+        n++;
+        break;
+
+      case sString:
+        // Skip the plain characters in one go
+        while(n < Length && Chunk[n] != Quote && Chunk[n] != '\\') n++;
+        if(n == Length) break;
+        n++;
+        if(Chunk[n-1] == '\\'){
+          State = sStringEscape;
+          break;
+        }
+        State = sSpace;
+        if(Carry.empty()){
+          if(!Token(Chunk + Start, n - Start)) return false;
+        }else{
+          Carry.append(Chunk, n);
+          if(!Token(Carry.data(), Carry.size())) return false;
+          Carry.clear();
+        }
+        break;
+
+      case sStringEscape:
+        if(Char == '\n') Line++;
+        State = sString;
+        n++;
+        break;
+
+      case sWord:
+        switch(Char){
+          case ' ' : case '\t': case '\n': case '\r': case '\v':
+          case '{' : case '}' : case '[' : case ']':
+          case ':' : case ',' : case '"' : case '\'': case '/':
+            State = sSpace;
+            if(Carry.empty()){
+              if(!Token(Chunk + Start, n - Start)) return false;
+            }else{
+              Carry.append(Chunk, n);
+              if(!Token(Carry.data(), Carry.size())) return false;
+              Carry.clear();
+            }
+            break; // The delimiter is processed in the sSpace state
+
+          default:
+            n++;
+            break;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  // Keep the start of a token that continues in the next chunk
+  if(State == sString || State == sStringEscape || State == sWord){
+    if(Carry.empty()) Carry.assign(Chunk + Start, Length - Start);
+    else              Carry.append(Chunk, Length);
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_STREAM::End(){
+  if(Failed) return false;
+
+  switch(State){
+    case sWord:
+      State = sSpace;
+      if(!Token(Carry.data(), Carry.size())) return false;
+      Carry.clear();
+      break;
+
+    case sString:
+    case sStringEscape:
+      return Error("Incomplete string");
+
+    case sSlash:
+      return Error("Unexpected \"/\"");
+
+    default:
+      break;
+  }
+  if(Expect != eDone){
+    if(Stack.empty()) return Error("Cannot parse JSON file");
+    else              return Error("Incomplete object");
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+
+// Shortest round-trip formatting of doubles, using the Grisu2 algorithm by
+// Florian Loitsch ("Printing Floating-Point Numbers Quickly and Accurately
+// with Integers", 2010).  The digits always parse back to the same double,
+// and are the shortest such digits in all but a small fraction of cases.
+
+// A floating-point number with a 64-bit mantissa: F * 2^E
+struct DIY_FP{
+  uint64_t F;
+  int      E;
+
+  DIY_FP(uint64_t F = 0, int E = 0){
+    this->F = F;
+    this->E = E;
+  }
+
+  DIY_FP operator* (const DIY_FP& Right) const{
+    // The upper 64 bits of the 128-bit product, rounded
+    const uint64_t Mask = 0xFFFFFFFF;
+    uint64_t A = F >> 32, B = F & Mask, C = Right.F >> 32, D = Right.F & Mask;
+    uint64_t AC = A*C, BC = B*C, AD = A*D, BD = B*D;
+    uint64_t Middle = (BD >> 32) + (AD & Mask) + (BC & Mask) + (1u << 31);
+    return DIY_FP(AC + (AD >> 32) + (BC >> 32) + (Middle >> 32), E + Right.E + 64);
+  }
+
+  DIY_FP Normalise() const{
+    DIY_FP Result = *this;
+    while(!(Result.F & (1ull << 63))){
+      Result.F <<= 1;
+      Result.E--;
+    }
+    return Result;
+  }
+};
+//------------------------------------------------------------------------------
+
+// Normalised 10^K, for K = -348, -340, ..., 340
+static const uint64_t CachedPowerF[] = {
+  0xFA8FD5A0081C0288, 0xBAAEE17FA23EBF76, 0x8B16FB203055AC76,
+  0xCF42894A5DCE35EA, 0x9A6BB0AA55653B2D, 0xE61ACF033D1A45DF,
+  0xAB70FE17C79AC6CA, 0xFF77B1FCBEBCDC4F, 0xBE5691EF416BD60C,
+  0x8DD01FAD907FFC3C, 0xD3515C2831559A83, 0x9D71AC8FADA6C9B5,
+  0xEA9C227723EE8BCB, 0xAECC49914078536D, 0x823C12795DB6CE57,
+  0xC21094364DFB5637, 0x9096EA6F3848984F, 0xD77485CB25823AC7,
+  0xA086CFCD97BF97F4, 0xEF340A98172AACE5, 0xB23867FB2A35B28E,
+  0x84C8D4DFD2C63F3B, 0xC5DD44271AD3CDBA, 0x936B9FCEBB25C996,
+  0xDBAC6C247D62A584, 0xA3AB66580D5FDAF6, 0xF3E2F893DEC3F126,
+  0xB5B5ADA8AAFF80B8, 0x87625F056C7C4A8B, 0xC9BCFF6034C13053,
+  0x964E858C91BA2655, 0xDFF9772470297EBD, 0xA6DFBD9FB8E5B88F,
+  0xF8A95FCF88747D94, 0xB94470938FA89BCF, 0x8A08F0F8BF0F156B,
+  0xCDB02555653131B6, 0x993FE2C6D07B7FAC, 0xE45C10C42A2B3B06,
+  0xAA242499697392D3, 0xFD87B5F28300CA0E, 0xBCE5086492111AEB,
+  0x8CBCCC096F5088CC, 0xD1B71758E219652C, 0x9C40000000000000,
+  0xE8D4A51000000000, 0xAD78EBC5AC620000, 0x813F3978F8940984,
+  0xC097CE7BC90715B3, 0x8F7E32CE7BEA5C70, 0xD5D238A4ABE98068,
+  0x9F4F2726179A2245, 0xED63A231D4C4FB27, 0xB0DE65388CC8ADA8,
+  0x83C7088E1AAB65DB, 0xC45D1DF942711D9A, 0x924D692CA61BE758,
+  0xDA01EE641A708DEA, 0xA26DA3999AEF774A, 0xF209787BB47D6B85,
+  0xB454E4A179DD1877, 0x865B86925B9BC5C2, 0xC83553C5C8965D3D,
+  0x952AB45CFA97A0B3, 0xDE469FBD99A05FE3, 0xA59BC234DB398C25,
+  0xF6C69A72A3989F5C, 0xB7DCBF5354E9BECE, 0x88FCF317F22241E2,
+  0xCC20CE9BD35C78A5, 0x98165AF37B2153DF, 0xE2A0B5DC971F303A,
+  0xA8D9D1535CE3B396, 0xFB9B7CD9A4A7443C, 0xBB764C4CA7A44410,
+  0x8BAB8EEFB6409C1A, 0xD01FEF10A657842C, 0x9B10A4E5E9913129,
+  0xE7109BFBA19C0C9D, 0xAC2820D9623BF429, 0x80444B5E7AA7CF85,
+  0xBF21E44003ACDD2D, 0x8E679C2F5E44FF8F, 0xD433179D9C8CB841,
+  0x9E19DB92B4E31BA9, 0xEB96BF6EBADF77D9, 0xAF87023B9BF0EE6B,
+};
+static const int16_t CachedPowerE[] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007,  -980,  -954,
+   -927,  -901,  -874,  -847,  -821,  -794,  -768,  -741,  -715,  -688,  -661,
+   -635,  -608,  -582,  -555,  -529,  -502,  -475,  -449,  -422,  -396,  -369,
+   -343,  -316,  -289,  -263,  -236,  -210,  -183,  -157,  -130,  -103,   -77,
+    -50,   -24,     3,    30,    56,    83,   109,   136,   162,   189,   216,
+    242,   269,   295,   322,   348,   375,   402,   428,   455,   481,   508,
+    534,   561,   588,   614,   641,   667,   694,   720,   747,   774,   800,
+    827,   853,   880,   907,   933,   960,   986,  1013,  1039,  1066,
+};
+//------------------------------------------------------------------------------
+
+// Returns a power of 10, 10^-K, that brings a number with binary exponent "E"
+// into the range in which the digits can be generated
+static DIY_FP GetCachedPower(int E, int* K){
+  double   dK    = (-61 - E) * 0.30102999566398114 + 347; // log10(2)
+  int      k     = (int)dK;
+  if(dK - k > 0.0) k++;
+  unsigned Index = (unsigned)((k >> 3) + 1);
+  *K = -(-348 + (int)(Index << 3));
+  return DIY_FP(CachedPowerF[Index], CachedPowerE[Index]);
+}
+//------------------------------------------------------------------------------
+
+static void GrisuRound(
+  char* Buffer, int Length, uint64_t Delta, uint64_t Rest,
+  uint64_t TenKappa, uint64_t Distance
+){
+  while(Rest < Distance && Delta - Rest >= TenKappa &&
+        (Rest + TenKappa < Distance ||
+         Distance - Rest > Rest + TenKappa - Distance)){
+    Buffer[Length - 1]--;
+    Rest += TenKappa;
+  }
+}
+//------------------------------------------------------------------------------
+
+static const uint64_t Pow10[] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+  100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+  1000000000000ull, 10000000000000ull, 100000000000000ull,
+  1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+  1000000000000000000ull, 10000000000000000000ull
+};
+//------------------------------------------------------------------------------
+
+// Generates the digits of W, as few as possible within the interval of
+// width "Delta" that ends at "Upper"
+static void DigitGen(
+  const DIY_FP& W, const DIY_FP& Upper, uint64_t Delta,
+  char* Buffer, int* Length, int* K
+){
+  const DIY_FP   One(1ull << -Upper.E, Upper.E);
+  const uint64_t Distance = Upper.F - W.F;
+
+  uint32_t P1    = (uint32_t)(Upper.F >> -One.E);
+  uint64_t P2    = Upper.F & (One.F - 1);
+  int      Kappa = 1;
+  while(Kappa < 10 && P1 >= Pow10[Kappa]) Kappa++;
+  *Length = 0;
+
+  while(Kappa > 0){
+    uint32_t Digit = P1 / Pow10[Kappa-1];
+    P1 %= Pow10[Kappa-1];
+    if(Digit || *Length) Buffer[(*Length)++] = '0' + Digit;
+    Kappa--;
+
+    uint64_t Rest = ((uint64_t)P1 << -One.E) + P2;
+    if(Rest <= Delta){
+      *K += Kappa;
+      GrisuRound(Buffer, *Length, Delta, Rest, Pow10[Kappa] << -One.E, Distance);
+      return;
+    }
+  }
+
+  for(;;){
+    P2    *= 10;
+    Delta *= 10;
+    char Digit = (char)(P2 >> -One.E);
+    if(Digit || *Length) Buffer[(*Length)++] = '0' + Digit;
+    P2 &= One.F - 1;
+    Kappa--;
+    if(P2 < Delta){
+      *K += Kappa;
+      GrisuRound(
+        Buffer, *Length, Delta, P2, One.F,
+        Distance * (-Kappa < 20 ? Pow10[-Kappa] : 0)
+      );
+      return;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+
+// Writes the digits of a positive, finite, non-zero value: Value = Buffer * 10^K
+static void Grisu2(double Value, char* Buffer, int* Length, int* K){
+  uint64_t Bits;
+  memcpy(&Bits, &Value, sizeof(Bits));
+
+  const uint64_t HiddenBit = 1ull << 52;
+  int            Exponent  = (int)((Bits >> 52) & 0x7FF);
+  uint64_t       Mantissa  = Bits & (HiddenBit - 1);
+
+  DIY_FP V;
+  if(Exponent) V = DIY_FP(Mantissa + HiddenBit, Exponent - 1075);
+  else         V = DIY_FP(Mantissa, -1074);
+
+  // The boundaries halfway to the neighbouring doubles
+  DIY_FP Upper = DIY_FP((V.F << 1) + 1, V.E - 1).Normalise();
+  DIY_FP Lower;
+  if(V.F == HiddenBit) Lower = DIY_FP((V.F << 2) - 1, V.E - 2);
+  else                 Lower = DIY_FP((V.F << 1) - 1, V.E - 1);
+  Lower.F <<= Lower.E - Upper.E;
+  Lower.E   = Upper.E;
+
+  DIY_FP Power = GetCachedPower(Upper.E, K);
+  DIY_FP W     = V.Normalise() * Power;
+  Upper = Upper * Power;
+  Lower = Lower * Power;
+  Upper.F--;
+  Lower.F++;
+  DigitGen(W, Upper, Upper.F - Lower.F, Buffer, Length, K);
+}
+//------------------------------------------------------------------------------
+
+// Writes the decimal digits of "Value" and returns the end of the string
+static char* FormatInteger(uint64_t Value, char* Buffer){
+  char  Digits[20];
+  char* Digit = Digits + sizeof(Digits);
+  do{
+    *--Digit = '0' + Value % 10;
+    Value /= 10;
+  }while(Value);
+
+  size_t Length = Digits + sizeof(Digits) - Digit;
+  memcpy(Buffer, Digit, Length);
+  return Buffer + Length;
+}
+//------------------------------------------------------------------------------
+
+// Writes the shortest decimal representation that parses back to the same
+// double and returns the end of the string.  The buffer must hold at least
+// 32 characters.  Infinity and NaN have no JSON representation, and are
+// written as "null".
+static char* FormatNumber(double Value, char* Buffer){
+  if(!isfinite(Value)){
+    memcpy(Buffer, "null", 4);
+    return Buffer + 4;
+  }
+  if(signbit(Value)){
+    *Buffer++ = '-';
+    Value = -Value;
+  }
+  if(Value == 0){
+    *Buffer++ = '0';
+    return Buffer;
+  }
+
+  char Digits[24];
+  int  Length, K;
+  Grisu2(Value, Digits, &Length, &K);
+
+  // Position of the decimal point relative to the first digit
+  int Point = Length + K;
+
+  if(0 < Point && Point <= 21){
+    if(K >= 0){ // Integer
+      memcpy(Buffer, Digits, Length);
+      memset(Buffer + Length, '0', K);
+      return Buffer + Point;
+    }
+    memcpy(Buffer, Digits, Point);
+    Buffer[Point] = '.';
+    memcpy(Buffer + Point + 1, Digits + Point, Length - Point);
+    return Buffer + Length + 1;
+  }
+
+  if(-6 < Point && Point <= 0){ // Small fraction
+    Buffer[0] = '0';
+    Buffer[1] = '.';
+    memset(Buffer + 2, '0', -Point);
+    memcpy(Buffer + 2 - Point, Digits, Length);
+    return Buffer + 2 - Point + Length;
+  }
+
+  // Scientific notation
+  *Buffer++ = Digits[0];
+  if(Length > 1){
+    *Buffer++ = '.';
+    memcpy(Buffer, Digits + 1, Length - 1);
+    Buffer += Length - 1;
+  }
+  *Buffer++ = 'e';
+  if(Point - 1 < 0){
+    *Buffer++ = '-';
+    return FormatInteger(1 - Point, Buffer);
+  }
+  *Buffer++ = '+';
+  return FormatInteger(Point - 1, Buffer);
+}
+//------------------------------------------------------------------------------
+
+JSON_WRITER::JSON_WRITER(int Indent){
+  Init(Indent);
+  Growable = true;
+}
+//------------------------------------------------------------------------------
+
+JSON_WRITER::JSON_WRITER(char* Buffer, size_t Size, int Indent){
+  Init(Indent);
+  if(Size){
+    this->Buffer = Buffer;
+    Capacity     = Size - 1;
+    Buffer[0]    = 0;
+  }
+}
+//------------------------------------------------------------------------------
+
+JSON_WRITER::JSON_WRITER(FILE_WRAPPER* File, int Indent){
+  Init(Indent);
+  this->File = File;
+  Capacity   = 64*kiB;
+  Buffer     = (char*)malloc(Capacity + 1);
+  if(!Buffer) throw std::bad_alloc();
+}
+//------------------------------------------------------------------------------
+
+JSON_WRITER::~JSON_WRITER(){
+  if(File) Flush();
+  if(Growable || File) free(Buffer);
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::Init(int Indent){
+  Buffer   = 0;
+  Capacity = 0;
+  Used     = 0;
+  Total    = 0;
+  Growable = false;
+  File     = 0;
+  Failed   = false;
+
+  this->Indent = Indent;
+  First        = true;
+  AfterKey     = false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::MakeRoom(size_t Length){
+  if(Growable){
+    size_t Size = Capacity ? 2*Capacity : 0x100;
+    while(Size < Used + Length) Size *= 2;
+    char* Data = (char*)realloc(Buffer, Size + 1);
+    if(!Data) throw std::bad_alloc();
+    Buffer   = Data;
+    Capacity = Size;
+    return true;
+  }
+  if(File){
+    if(Used && File->Write(Buffer, Used) != Used) Failed = true;
+    Used = 0;
+    if(Length <= Capacity) return true;
+    // Too large to buffer: written straight through by the caller
+    return false;
+  }
+  Failed = true;
+  return false;
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::Write(const char* Data, size_t Length){
+  if(!Length) return;
+
+  Total += Length;
+  if(Used + Length > Capacity && !MakeRoom(Length)){
+    if(File){
+      if(File->Write(Data, Length) != Length) Failed = true;
+    }else if(Used < Capacity){ // Keep what fits in a fixed buffer
+      memcpy(Buffer + Used, Data, Capacity - Used);
+      Used = Capacity;
+    }
+    return;
+  }
+  memcpy(Buffer + Used, Data, Length);
+  Used += Length;
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::Write(char Char){
+  Total++;
+  if(Used == Capacity && !MakeRoom(1)) return;
+  Buffer[Used++] = Char;
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::NewLine(){
+  static const char Spaces[] = "                                ";
+
+  Write('\n');
+  size_t Length = Indent * Stack.size();
+  while(Length){
+    size_t Chunk = Length < sizeof(Spaces)-1 ? Length : sizeof(Spaces)-1;
+    Write(Spaces, Chunk);
+    Length -= Chunk;
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::BeginValue(){
+  if(AfterKey){
+    AfterKey = false;
+    return;
+  }
+  if(Stack.empty()){
+    if(Total) Write('\n'); // Consecutive top-level values
+    return;
+  }
+  if(!First) Write(',');
+  First = false;
+  if(Indent) NewLine();
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::WriteString(const char* Value, size_t Length){
+  Write('"');
+
+  // Runs that need no escaping are copied in one go
+  size_t Start = 0;
+  for(size_t n = 0; n < Length; n++){
+    byte Char = Value[n];
+    if(Char >= 0x20 && Char != '"' && Char != '\\' && Char != '/') continue;
+
+    Write(Value + Start, n - Start);
+    Start = n + 1;
+    switch(Char){
+      case  '"': Write("\\\"", 2); break;
+      case '\\': Write("\\\\", 2); break;
+      case  '/': Write("\\/" , 2); break;
+      case '\b': Write("\\b" , 2); break;
+      case '\f': Write("\\f" , 2); break;
+      case '\n': Write("\\n" , 2); break;
+      case '\r': Write("\\r" , 2); break;
+      case '\t': Write("\\t" , 2); break;
+      default:{
+        char s[8];
+        sprintf(s, "\\u%04X", Char);
+        Write(s, 6);
+        break;
+      }
+    }
+  }
+  Write(Value + Start, Length - Start);
+  Write('"');
+}
+//------------------------------------------------------------------------------
+
+const char* JSON_WRITER::GetBuffer(){
+  if(!Buffer) return "";
+  Buffer[Used] = 0;
+  return Buffer;
+}
+//------------------------------------------------------------------------------
+
+size_t JSON_WRITER::GetLength(){
+  return Total;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Raw(const char* Json, size_t Length){
+  BeginValue();
+  Write(Json, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+void JSON_WRITER::Continue(size_t Depth, bool First){
+  Stack.assign(Depth, false);
+  this->First = First;
+  AfterKey    = false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Insert(const char* Json, size_t Length){
+  Write(Json, Length);
+  if(Length) First = false;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Flush(){
+  if(File && Used){
+    if(File->Write(Buffer, Used) != Used) Failed = true;
+    Used = 0;
+  }
+  return !Failed;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Null(){
+  BeginValue();
+  Write("null", 4);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Bool(bool Value){
+  BeginValue();
+  if(Value) Write("true" , 4);
+  else      Write("false", 5);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Number(double Value){
+  char s[32];
+  BeginValue();
+  Write(s, FormatNumber(Value, s) - s);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Integer(int64_t Value){
+  char  s[32];
+  char* End = s;
+  BeginValue();
+  if(Value < 0) *End++ = '-';
+  End = FormatInteger(Value < 0 ? 0 - (uint64_t)Value : Value, End);
+  Write(s, End - s);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Unsigned(uint64_t Value){
+  char s[32];
+  BeginValue();
+  Write(s, FormatInteger(Value, s) - s);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::String(const char* Value, size_t Length){
+  BeginValue();
+  WriteString(Value, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::StartObject(){
+  BeginValue();
+  Write('{');
+  Stack.push_back(First);
+  First = true;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::Key(const char* Name, size_t Length){
+  BeginValue();
+  WriteString(Name, Length);
+  Write(':');
+  if(Indent) Write(' ');
+  AfterKey = true;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::EndObject(){
+  bool Empty = First;
+  First = Stack.back();
+  Stack.pop_back();
+  if(Indent && !Empty) NewLine();
+  Write('}');
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::StartArray(){
+  BeginValue();
+  Write('[');
+  Stack.push_back(First);
+  First = true;
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_WRITER::EndArray(){
+  bool Empty = First;
+  First = Stack.back();
+  Stack.pop_back();
+  if(Indent && !Empty) NewLine();
+  Write(']');
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Emit(JSON_HANDLER* Handler) const{
+  switch(Type){
+    case typeNull:
+      return Handler->Null();
+
+    case typeTrue:
+      return Handler->Bool(true);
+
+    case typeFalse:
+      return Handler->Bool(false);
+
+    case typeString:
+      return Handler->String(String.c_str(), String.length());
+
+    case typeNumber:
+      if(Integer == intSigned  ) return Handler->Integer (Signed  );
+      if(Integer == intUnsigned) return Handler->Unsigned(Unsigned);
+      return Handler->Number(Number);
+
+    case typeObject:
+      if(Lazy){
+        JSON_READER Reader;
+        Reader.SetFeatures(Lazy->Features);
+        return Reader.Parse(Handler, Lazy->Data, Lazy->Length);
+      }
+      if(!Handler->Size(Objects.size()) || !Handler->StartObject()) return false;
+      for(
+        auto Object = Objects.begin();
+        Object != Objects.end();
+        Object++
+      ){
+        if(!Handler->Key(Object->first.c_str(), Object->first.length())) return false;
+        if(!Object->second->Emit(Handler)) return false;
+      }
+      return Handler->EndObject();
+
+    case typeArray:
+      if(Lazy && Lazy->Packing != pkText){
+        if(!Handler->Size(Lazy->Length) || !Handler->StartArray()) return false;
+        for(size_t n = 0; n < Lazy->Length; n++){
+          if(Lazy->Packing == pkInt64){
+            if(!Handler->Integer(((const int64_t*)Lazy->Data)[n])) return false;
+          }else{
+            if(!Handler->Number (((const double *)Lazy->Data)[n])) return false;
+          }
+        }
+        return Handler->EndArray();
+      }
+      if(Lazy){
+        JSON_READER Reader;
+        Reader.SetFeatures(Lazy->Features);
+        return Reader.Parse(Handler, Lazy->Data, Lazy->Length);
+      }
+      if(!Handler->Size(Items.size()) || !Handler->StartArray()) return false;
+      for(size_t n = 0; n < Items.size(); n++){
+        if(!Items[n]->Emit(Handler)) return false;
+      }
+      return Handler->EndArray();
+
+    default:
+      return true;
+  }
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Serialise(JSON_WRITER* Writer, const char* Previous, size_t ParentStart){
+  // Lazy values are streamed from their source text every time
+  if((Type != typeObject && Type != typeArray) || Lazy){
+    Cached = false;
+    Clean  = true;
+    return Emit(Writer);
+  }
+
+  size_t Start;
+  if(Previous && Clean){
+    Writer->Raw(Previous, CacheLength);
+    Start = Writer->GetLength() - CacheLength;
+
+  }else if(Type == typeObject){
+    Writer->StartObject();
+    Start = Writer->GetLength() - 1;
+    for(
+      auto Object = Objects.begin();
+      Object != Objects.end();
+      Object++
+    ){
+      JSON* Value = Object->second;
+      Writer->Key(Object->first.c_str(), Object->first.length());
+      if(!Value->Serialise(Writer, Previous && Value->Cached ? Previous + Value->CacheOffset : 0, Start)){
+        return false;
+      }
+    }
+    Writer->EndObject();
+
+  }else{
+    Writer->StartArray();
+    Start = Writer->GetLength() - 1;
+    for(size_t n = 0; n < Items.size(); n++){
+      JSON* Value = Items[n];
+      if(!Value->Serialise(Writer, Previous && Value->Cached ? Previous + Value->CacheOffset : 0, Start)){
+        return false;
+      }
+    }
+    Writer->EndArray();
+  }
+
+  size_t Length = Writer->GetLength() - Start;
+  Cached      = Start - ParentStart <= UINT32_MAX && Length <= UINT32_MAX;
+  CacheOffset = (uint32_t)(Start - ParentStart);
+  CacheLength = (uint32_t)Length;
+  Clean       = true;
   return true;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadIdentifierStart(string* String){
-  if('A' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'Z'){
-    *String += ReadBuffer[ReadIndex++];
-    return true;
-  }
-  if('a' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'z'){
-    *String += ReadBuffer[ReadIndex++];
-    return true;
+const char* JSON::Stringify(int Indent){
+  DOCUMENT* Document = GetDocument();
+  STRING*   Text     = &Document->Stringification;
+
+  // Only the root of a document keeps track of its previous output
+  const char* Previous = 0;
+  if(!Parent && Cached && Document->Indent == Indent) Previous = Text->c_str();
+  if(Previous && Clean) return Previous;
+
+  JSON_WRITER Writer(Indent);
+  bool        Result = Parent ? Emit(&Writer) : Serialise(&Writer, Previous, 0);
+  if(!Result){
+    Text->Assign("", 0);
+    Cached = false;
+    return 0;
   }
-  if(ReadBuffer[ReadIndex] == '$' || ReadBuffer[ReadIndex] == '_'){
-    *String += ReadBuffer[ReadIndex++];
-    return true;
+  // The root of an arena document keeps its text on the heap, so that longer
+  // output does not leave the previous copy in the arena until Clear().
+  // Other nodes in an arena also have their DOCUMENT there, which is never
+  // destroyed.
+  Text->Assign(Writer.GetBuffer(), Writer.GetLength(), Document->Arena ? 0 : Arena);
+  Document->Indent = Indent;
+  return Text->c_str();
+}
+//------------------------------------------------------------------------------
+
+size_t JSON::Stringify(char* Buffer, size_t Size, int Indent) const{
+  JSON_WRITER Writer(Buffer, Size, Indent);
+  if(!Emit(&Writer)){
+    if(Size) Buffer[0] = 0;
+    return 0;
   }
-  // This is actually wrong, but works when the input is assumed valid
-  if(ReadBuffer[ReadIndex] & 0xC0){
-    *String += ReadBuffer[ReadIndex++];
-    while((ReadBuffer[ReadIndex] & 0xC0) == 0x80) *String += ReadBuffer[ReadIndex++];
-    return true;
+  Writer.GetBuffer();
+  return Writer.GetLength();
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Stringify(std::string* Result, int Indent, unsigned Threads) const{
+  JSON_WRITER Writer(Indent);
+  if(!Emit(&Writer, Indent, Threads)){
+    Result->clear();
+    return false;
   }
-  if(ReadBuffer[ReadIndex] == '\\'){
-    ReadIndex++;
-    if(!ReadUnicodeSequence(String)){
-      ReadError("Incomplete Unicode escape sequence");
-      return false;
+  Result->assign(Writer.GetBuffer(), Writer.GetLength());
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON::Stringify(FILE_WRAPPER* File, int Indent, unsigned Threads) const{
+  JSON_WRITER Writer(File, Indent);
+  bool        Result = Emit(&Writer, Indent, Threads);
+  return Writer.Flush() && Result;
+}
+//------------------------------------------------------------------------------
+
+// Containers with fewer items are not worth splitting
+static const size_t MinimumSplit = 0x400;
+//------------------------------------------------------------------------------
+
+bool JSON::Emit(JSON_WRITER* Writer, int Indent, unsigned Threads) const{
+  if(!Threads) Threads = std::thread::hardware_concurrency();
+  if(Threads < 2) return Emit(Writer);
+
+  // Follow the largest container down from the root, until it is large
+  // enough to split
+  std::vector<const JSON*> Path;
+  const JSON*              Node = this;
+  size_t                   Size = 0;
+  while(Node){
+    Path.push_back(Node);
+    if(Node->Type != typeObject && Node->Type != typeArray) return Emit(Writer);
+    if(Node->Lazy) return Emit(Writer);
+
+    Size = Node->Type == typeObject ? Node->Objects.size() : Node->Items.size();
+    if(Size >= MinimumSplit) break;
+
+    const JSON* Largest = 0;
+    size_t      Count   = 0;
+    for(size_t n = 0; n < Size; n++){
+      const JSON* Child = Node->Type == typeObject ? Node->Objects.begin()[n].second : Node->Items[n];
+      if(Child->Type != typeObject && Child->Type != typeArray) continue;
+      if(Child->Lazy) continue; // Streamed from text, or packed
+      size_t Items = Child->Type == typeObject ? Child->Objects.size() : Child->Items.size();
+      if(Items > Count){
+        Largest = Child;
+        Count   = Items;
+      }
     }
-    return true;
+    Node = Largest;
   }
-  return false;
+  if(!Node) return Emit(Writer);
+
+  // Several chunks per thread balance the load when items differ in size
+  std::vector<std::string> Chunks(4*Threads);
+  std::atomic<size_t>      Next(0);
+  std::atomic<bool>        Failed(false);
+  auto Work = [&](){
+    for(size_t c = Next++; c < Chunks.size() && !Failed; c = Next++){
+      size_t Begin = Size *  c    / Chunks.size();
+      size_t End   = Size * (c+1) / Chunks.size();
+
+      JSON_WRITER Chunk(Indent);
+      Chunk.Continue(Path.size(), Begin == 0);
+      for(size_t n = Begin; n < End; n++){
+        if(Node->Type == typeObject){
+          const MEMBER& Member = Node->Objects.begin()[n];
+          Chunk.Key(Member.first.c_str(), Member.first.length());
+          if(!Member.second->Emit(&Chunk)) Failed = true;
+        }else{
+          if(!Node->Items[n]->Emit(&Chunk)) Failed = true;
+        }
+      }
+      Chunks[c].assign(Chunk.GetBuffer(), Chunk.GetLength());
+    }
+  };
+  std::vector<std::thread> Pool;
+  for(unsigned n = 1; n < Threads; n++) Pool.emplace_back(Work);
+  Work();
+  for(size_t n = 0; n < Pool.size(); n++) Pool[n].join();
+
+  if(Failed) return false;
+  return EmitPath(Writer, Path, 0, Chunks);
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadIdentifierPart(string* String){
-  if(ReadIdentifierStart(String)) return true;
+bool JSON::EmitPath(
+  JSON_WRITER*                    Writer,
+  const std::vector<const JSON*>& Path,
+  size_t                          Level,
+  const std::vector<std::string>& Chunks
+) const{
+  if(Type == typeObject){
+    Writer->Size(Objects.size());
+    Writer->StartObject();
+  }else{
+    Writer->Size(Items.size());
+    Writer->StartArray();
+  }
 
-  if('0' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= '9'){
-    *String += ReadBuffer[ReadIndex++];
-    return true;
+  if(Level+1 == Path.size()){
+    for(size_t n = 0; n < Chunks.size(); n++){
+      Writer->Insert(Chunks[n].data(), Chunks[n].size());
+    }
+  }else if(Type == typeObject){
+    for(
+      auto Object = Objects.begin();
+      Object != Objects.end();
+      Object++
+    ){
+      Writer->Key(Object->first.c_str(), Object->first.length());
+      bool Result;
+      if(Object->second == Path[Level+1]) Result = Object->second->EmitPath(Writer, Path, Level+1, Chunks);
+      else                                Result = Object->second->Emit(Writer);
+      if(!Result) return false;
+    }
+  }else{
+    for(size_t n = 0; n < Items.size(); n++){
+      bool Result;
+      if(Items[n] == Path[Level+1]) Result = Items[n]->EmitPath(Writer, Path, Level+1, Chunks);
+      else                          Result = Items[n]->Emit(Writer);
+      if(!Result) return false;
+    }
   }
-  return false;
+
+  if(Type == typeObject) Writer->EndObject();
+  else                   Writer->EndArray ();
+  return true;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadIdentifier(string* String){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
 
-  *String = "";
+JSON_POINTER::JSON_POINTER(){
+  Wildcard = false;
+}
+//------------------------------------------------------------------------------
 
-  if(!ReadIdentifierStart(String)) return false;
+bool JSON_POINTER::Compile(const char* Pointer, bool Extended){
+  Segments.clear();
+  Wildcard = false;
 
-  while(ReadIdentifierPart(String));
+  if(!*Pointer) return true; // The whole document
+  if(*Pointer != '/') return false;
+
+  while(*Pointer == '/'){
+    Pointer++;
+    size_t Length = strcspn(Pointer, "/");
+
+    SEGMENT Segment;
+    Segment.Kind    = SEGMENT::kName;
+    Segment.Hash    = 0;
+    Segment.IsIndex = false;
+    Segment.Start   = 0;
+    Segment.End     = 0;
+
+    const char* Colon = (const char*)memchr(Pointer, ':', Length);
+
+    if(Extended && Length == 1 && *Pointer == '*'){
+      Segment.Kind = SEGMENT::kAll;
+
+    }else if(
+      Extended && Colon &&
+      strspn(Pointer, "0123456789") == (size_t)(Colon - Pointer) &&
+      strspn(Colon+1, "0123456789") == Length - (Colon - Pointer) - 1
+    ){
+      Segment.Kind  = SEGMENT::kSlice;
+      Segment.Start = Colon > Pointer            ? strtoull(Pointer, 0, 10) : 0;
+      Segment.End   = Colon < Pointer + Length-1 ? strtoull(Colon+1, 0, 10) : SIZE_MAX;
+
+    }else{
+      for(size_t n = 0; n < Length; n++){
+        if(Pointer[n] != '~'){
+          Segment.Name += Pointer[n];
+          continue;
+        }
+        n++;
+        if     (n < Length && Pointer[n] == '0') Segment.Name += '~';
+        else if(n < Length && Pointer[n] == '1') Segment.Name += '/';
+        else return false;
+      }
+      Segment.Hash = JSON::OBJECTS::Hash(Segment.Name.data(), Segment.Name.length());
+
+      // Array indices have no leading zeros; "-" (past the end) never matches
+      const char* Name = Segment.Name.c_str();
+      if(
+        !Segment.Name.empty() && Segment.Name.length() <= 19 &&
+        strspn(Name, "0123456789") == Segment.Name.length() &&
+        (Name[0] != '0' || !Name[1])
+      ){
+        Segment.IsIndex = true;
+        Segment.Start   = strtoull(Name, 0, 10);
+      }
+    }
+    if(Segment.Kind != SEGMENT::kName) Wildcard = true;
+    Segments.push_back(std::move(Segment));
 
+    Pointer += Length;
+  }
   return true;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadString(string* Value){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
+bool JSON_POINTER::Matches(size_t Depth, const char* Name, size_t Length) const{
+  const SEGMENT& Segment = Segments[Depth];
 
-  bool DoubleQuotes;
-  if     (ReadBuffer[ReadIndex] == '"' ) DoubleQuotes = true;
-  else if(ReadBuffer[ReadIndex] == '\'') DoubleQuotes = false;
-  else return false;
-  ReadIndex++;
+  switch(Segment.Kind){
+    case SEGMENT::kAll:
+      return true;
 
-  *Value = "";
+    case SEGMENT::kName:
+      return Segment.Name.length() == Length && !memcmp(Segment.Name.data(), Name, Length);
 
-  while(ReadIndex < ReadSize){
-    switch(ReadBuffer[ReadIndex]){
-      case '"':
-        if(DoubleQuotes){
-          ReadIndex++;
-          return true;
-        }
-        *Value += ReadBuffer[ReadIndex];
-        break;
+    default:
+      return false;
+  }
+}
+//------------------------------------------------------------------------------
 
-      case '\'':
-        if(!DoubleQuotes){
-          ReadIndex++;
-          return true;
-        }
-        *Value += ReadBuffer[ReadIndex];
-        break;
+bool JSON_POINTER::Matches(size_t Depth, size_t Index) const{
+  const SEGMENT& Segment = Segments[Depth];
 
-      case '\\':
-        ReadIndex++;
-        if(ReadIndex >= ReadSize){
-          ReadError("Incomplete escape sequence");
-          return false;
-        }
-        switch(ReadBuffer[ReadIndex]){
-          case '"' : *Value += '"' ; break;
-          case '\'': *Value += '\''; break;
-          case '\\': *Value += '\\'; break;
-          case '/' : *Value += '/' ; break;
-          case 'b' : *Value += '\b'; break;
-          case 'f' : *Value += '\f'; break;
-          case 'n' : *Value += '\n'; break;
-          case 'r' : *Value += '\r'; break;
-          case 't' : *Value += '\t'; break;
-          case 'u' :
-            if(!ReadUnicodeSequence(Value)){
-              ReadError("Incomplete Unicode escape sequence");
-              return false;
-            }
-            break;
-          case '\n':
-            ReadLine++;
-            if(ReadBuffer[ReadIndex+1] == '\r') ReadIndex++;
-            break;
-          case '\r':
-            ReadLine++;
-            if(ReadBuffer[ReadIndex+1] == '\n') ReadIndex++;
-            break;
+  switch(Segment.Kind){
+    case SEGMENT::kAll:
+      return true;
 
-          default:
-            ReadError("Unrecognised escape sequence");
-            return false;
-        }
-        break;
+    case SEGMENT::kSlice:
+      return Index >= Segment.Start && Index < Segment.End;
 
-      case '\b':
-      case '\f':
-      case '\n':
-      case '\r':
-        ReadError("Unexpected control character in string");
-        return false;
+    default:
+      return Segment.IsIndex && Index == Segment.Start;
+  }
+}
+//------------------------------------------------------------------------------
 
-      default:
-        *Value += ReadBuffer[ReadIndex];
-        break;
+JSON* JSON_POINTER::Search(JSON* Node, size_t Depth, std::vector<JSON*>* Results) const{
+  // Without wildcards there is at most one match, so no recursion is needed
+  while(Depth < Segments.size() && Segments[Depth].Kind == SEGMENT::kName){
+    const SEGMENT& Segment = Segments[Depth];
+    Node->Materialise();
+
+    if(Node->Type == JSON::typeObject){
+      auto Member = Node->Objects.find(Segment.Name.data(), Segment.Name.length(), Segment.Hash);
+      if(Member == Node->Objects.end()) return 0;
+      Node = Member->second;
+
+    }else if(Node->Type == JSON::typeArray){
+      if(!Segment.IsIndex || Segment.Start >= Node->Items.size()) return 0;
+      Node = Node->Items[Segment.Start];
+
+    }else{
+      return 0;
     }
-    ReadIndex++;
+    Depth++;
   }
-  ReadError("Incomplete string");
-  return false;
+
+  if(Depth == Segments.size()){
+    if(Results) Results->push_back(Node);
+    return Node;
+  }
+
+  JSON* First = 0;
+  Node->Materialise();
+
+  if(Node->Type == JSON::typeObject){
+    if(Segments[Depth].Kind != SEGMENT::kAll) return 0;
+
+    for(auto Member = Node->Objects.begin(); Member != Node->Objects.end(); Member++){
+      JSON* Match = Search(Member->second, Depth+1, Results);
+      if(!First) First = Match;
+      if(First && !Results) break;
+    }
+
+  }else if(Node->Type == JSON::typeArray){
+    for(size_t n = 0; n < Node->Items.size(); n++){
+      if(!Matches(Depth, n)) continue;
+      JSON* Match = Search(Node->Items[n], Depth+1, Results);
+      if(!First) First = Match;
+      if(First && !Results) break;
+    }
+  }
+  return First;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadString(JSON* Value){
-  if(ReadString(&(Value->String))){
-    Value->Type = typeString;
-    return true;
+JSON* JSON_POINTER::Find(JSON* Document) const{
+  return Search(Document, 0, 0);
+}
+//------------------------------------------------------------------------------
+
+size_t JSON_POINTER::FindAll(JSON* Document, std::vector<JSON*>* Results) const{
+  size_t Count = Results->size();
+  Search(Document, 0, Results);
+  return Results->size() - Count;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::Extract(JSON_HANDLER* Handler, const char* json, size_t Length) const{
+  FILTER      Filter(this, Handler);
+  JSON_READER Reader;
+
+  if(Reader.Parse(&Filter, json, Length)) return true;
+  return Filter.Done;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::Extract(JSON* Result, const char* json, size_t Length) const{
+  Result->BeginParse(0);
+
+  JSON::BUILDER Builder(Result, 0);
+  Builder.StartArray();
+  if(!Extract(&Builder, json, Length)){
+    Result->Clear();
+    return false;
+  }
+  return Builder.EndArray();
+}
+//------------------------------------------------------------------------------
+
+JSON_POINTER::FILTER::FILTER(const JSON_POINTER* Pointer, JSON_HANDLER* Handler){
+  this->Pointer = Pointer;
+  this->Handler = Handler;
+  Forward       = 0;
+  Count         = 0;
+  Done          = false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Begin(){
+  if(Stack.empty()) return true; // The root
+
+  FRAME& Parent = Stack.back();
+  if(Parent.Array){
+    size_t Index = Parent.Index++;
+    return Parent.OnPath && Pointer->Matches(Stack.size()-1, Index);
   }
+  return Parent.Member;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Matched(){
+  Count++;
+  if(Pointer->Wildcard) return true;
+  Done = true;
   return false;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadHexadecimal(JSON* Value, bool Sign){
-  double Result = 0;
+bool JSON_POINTER::FILTER::Null(){
+  if(Forward) return Handler->Null();
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->Null() && Matched();
+}
+//------------------------------------------------------------------------------
 
-  while(ReadIndex < ReadSize){
-    if      ('0' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= '9'){
-      Result *= 16.0;
-      Result += ReadBuffer[ReadIndex++] - '0';
-    }else if('a' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'f'){
-      Result *= 16.0;
-      Result += ReadBuffer[ReadIndex++] - 'a' + 10;
-    }else if('A' <= ReadBuffer[ReadIndex] && ReadBuffer[ReadIndex] <= 'F'){
-      Result *= 16.0;
-      Result += ReadBuffer[ReadIndex++] - 'A' + 10;
-    }else{
-      break;
-    }
+bool JSON_POINTER::FILTER::Bool(bool Value){
+  if(Forward) return Handler->Bool(Value);
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->Bool(Value) && Matched();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Number(double Value){
+  if(Forward) return Handler->Number(Value);
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->Number(Value) && Matched();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::String(const char* Value, size_t Length){
+  if(Forward) return Handler->String(Value, Length);
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->String(Value, Length) && Matched();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Integer(int64_t Value){
+  if(Forward) return Handler->Integer(Value);
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->Integer(Value) && Matched();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Unsigned(uint64_t Value){
+  if(Forward) return Handler->Unsigned(Value);
+  if(!Begin() || Stack.size() != Pointer->Segments.size()) return true;
+  return Handler->Unsigned(Value) && Matched();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::StartObject(){
+  if(Forward){
+    Forward++;
+    return Handler->StartObject();
+  }
+  bool OnPath = Begin();
+  if(OnPath && Stack.size() == Pointer->Segments.size()){
+    Forward = 1;
+    return Handler->StartObject();
+  }
+  FRAME Frame = {false, OnPath, false, 0};
+  Stack.push_back(Frame);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::Key(const char* Name, size_t Length){
+  if(Forward) return Handler->Key(Name, Length);
+
+  FRAME& Frame = Stack.back();
+  Frame.Member = Frame.OnPath && Pointer->Matches(Stack.size()-1, Name, Length);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_POINTER::FILTER::EndObject(){
+  if(Forward){
+    Forward--;
+    if(!Handler->EndObject()) return false;
+    return Forward || Matched();
+  }
+  bool OnPath = Stack.back().OnPath;
+  Stack.pop_back();
+
+  // Without wildcards, the only candidate was inside this object
+  if(OnPath && !Pointer->Wildcard){
+    Done = true;
+    return false;
   }
-  Value->Number = Sign ? -Result : Result;
   return true;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadNumber(JSON* Value){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
-
-  if(ReadIndex+8 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "Infinity", 8)){
-    ReadIndex += 8;
-    Value->Type   = typeNumber;
-    Value->Number = 1.0/0.0;
-    return true;
-  }
-  if(ReadIndex+9 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "-Infinity", 9)){
-    ReadIndex += 9;
-    Value->Type   = typeNumber;
-    Value->Number = -1.0/0.0;
-    return true;
+bool JSON_POINTER::FILTER::StartArray(){
+  if(Forward){
+    Forward++;
+    return Handler->StartArray();
   }
-  if(ReadIndex+3 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "NaN", 3)){
-    ReadIndex += 3;
-    Value->Type   = typeNumber;
-    Value->Number = 0.0/0.0;
-    return true;
+  bool OnPath = Begin();
+  if(OnPath && Stack.size() == Pointer->Segments.size()){
+    Forward = 1;
+    return Handler->StartArray();
   }
+  FRAME Frame = {true, OnPath, false, 0};
+  Stack.push_back(Frame);
+  return true;
+}
+//------------------------------------------------------------------------------
 
-  bool Sign         = false;
-  bool ExponentSign = false;
-
-  if(ReadBuffer[ReadIndex] == '-'){
-    Sign = true;
-    ReadIndex++;
-    if(ReadIndex >= ReadSize) return false;
-  }else if(ReadBuffer[ReadIndex] == '+'){
-    Sign = false;
-    ReadIndex++;
-    if(ReadIndex >= ReadSize) return false;
+bool JSON_POINTER::FILTER::EndArray(){
+  if(Forward){
+    Forward--;
+    if(!Handler->EndArray()) return false;
+    return Forward || Matched();
   }
+  bool OnPath = Stack.back().OnPath;
+  Stack.pop_back();
 
-  if((ReadBuffer[ReadIndex] <  '0' || ReadBuffer[ReadIndex] > '9') &&
-      ReadBuffer[ReadIndex] != '.' ){
-    if(Sign) ReadError("Incomplete number");
+  if(OnPath && !Pointer->Wildcard){
+    Done = true;
     return false;
   }
+  return true;
+}
+//------------------------------------------------------------------------------
 
-  if(ReadIndex+2 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "0x", 2)){
-    ReadIndex += 2;
-    Value->Type = typeNumber;
-    return ReadHexadecimal(Value, Sign);
-  }
-  if(ReadIndex+2 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "0X", 2)){
-    ReadIndex += 2;
-    Value->Type = typeNumber;
-    return ReadHexadecimal(Value, Sign);
-  }
+struct JSON_LINES::JOB{
+  HANDLER*    Handler;
+  bool        Ordered;
+  const char* Data;
+  size_t      Size;
 
-  *Value = 0;
+  std::mutex Split;    // Guards the two members below
+  size_t     Position; // Start of the next batch
+  size_t     Batches;  // Batches handed out so far
 
-  double Result   = 0;
-  double Fraction = 0;
-  double Exponent = 0;
+  std::mutex              Order;     // Guards "Delivered"; held while delivering
+  std::condition_variable Turn;
+  size_t                  Delivered; // Batches passed to the handler so far
 
-  if(ReadBuffer[ReadIndex] == '0'){
-    ReadIndex++;
-    if(ReadIndex >= ReadSize) return true;
-    if(ReadBuffer[ReadIndex] >= '0' && ReadBuffer[ReadIndex] <= '9'){
-      ReadError("Invalid number format");
-      return false;
-    }
-  }
+  std::atomic<bool> Stopped;
+  std::atomic<bool> Failed;
+};
+//------------------------------------------------------------------------------
 
-  while(ReadIndex < ReadSize){
-    if(ReadBuffer[ReadIndex] < '0' || ReadBuffer[ReadIndex] > '9') break;
-    Result = 10.0*Result + (ReadBuffer[ReadIndex] - '0');
-    ReadIndex++;
-  }
+JSON_LINES::JSON_LINES(unsigned Threads, size_t BatchSize){
+  if(!Threads) Threads = std::thread::hardware_concurrency();
+  if(!Threads) Threads = 1;
 
-  if(ReadBuffer[ReadIndex] == '.'){
-    ReadIndex++;
-    Fraction = 0.1;
-    while(ReadIndex < ReadSize){
-      if(ReadBuffer[ReadIndex] < '0' || ReadBuffer[ReadIndex] > '9') break;
-      Result += Fraction * (ReadBuffer[ReadIndex] - '0');
-      Fraction /= 10.0;
-      ReadIndex++;
+  this->Threads   = Threads;
+  this->BatchSize = BatchSize ? BatchSize : 1;
+  Features        = JSON_READER::JSON5;
+}
+//------------------------------------------------------------------------------
+
+void JSON_LINES::SetFeatures(unsigned Features){
+  this->Features = Features;
+}
+//------------------------------------------------------------------------------
+
+void JSON_LINES::Work(JOB* Job){
+  struct RECORD{
+    uint64_t Offset;
+    JSON*    Value; // Null if it could not be parsed
+  };
+  JSON                Document; // Only used for its arena
+  JSON_READER         Reader;
+  std::vector<RECORD> Records;
+
+  Reader.SetFeatures(Features);
+
+  while(!Job->Stopped){
+    size_t Start, End, Batch;
+    {
+      std::lock_guard<std::mutex> Lock(Job->Split);
+      if(Job->Position >= Job->Size) break;
+
+      Start = Job->Position;
+      End   = Start + BatchSize;
+      if(End >= Job->Size){
+        End = Job->Size;
+      }else{
+        const char* NewLine = (const char*)memchr(Job->Data + End, '\n', Job->Size - End);
+        End = NewLine ? NewLine - Job->Data + 1 : Job->Size;
+      }
+      Job->Position = End;
+      Batch = Job->Batches++;
     }
-  }
 
-  if(ReadBuffer[ReadIndex] == 'e' || ReadBuffer[ReadIndex] == 'E'){
-    ReadIndex++;
-    if(ReadIndex >= ReadSize){
-      ReadError("Incomplete number");
-      return false;
+    // Records are kept until the whole batch is delivered
+    Document.BeginParse(JSON::pfArena);
+    Records.clear();
+
+    for(size_t Line = Start; Line < End;){
+      const char* Data = Job->Data + Line;
+      const char* Next = (const char*)memchr(Data, '\n', End - Line);
+      size_t      Size = Next ? Next - Data : End - Line;
+
+      size_t Space = 0;
+      while(Space < Size && IsSpace<true>(Data[Space])) Space++;
+
+      if(Space < Size){
+        RECORD Record = {Line, Document.NewNode()};
+        Record.Value->Parent = 0; // Each record is a root of its own
+        JSON::BUILDER Builder(Record.Value, &Reader);
+        // A line holds exactly one value
+        if(!Reader.Parse(&Builder, Data, Size) || !Reader.AtEnd()) Record.Value = 0;
+        Records.push_back(Record);
+      }
+      Line += Size + 1;
     }
-    if(ReadBuffer[ReadIndex] == '-' || ReadBuffer[ReadIndex] == '+'){
-      ExponentSign = true;
-      ReadIndex++;
+
+    std::unique_lock<std::mutex> Lock(Job->Order, std::defer_lock);
+    if(Job->Ordered){
+      Lock.lock();
+      Job->Turn.wait(Lock, [&]{ return Job->Delivered == Batch || Job->Stopped; });
     }
-    if(ReadIndex >= ReadSize){
-      ReadError("Incomplete number");
-      return false;
+    for(size_t n = 0; n < Records.size() && !Job->Stopped; n++){
+      bool Continue;
+      if(Records[n].Value){
+        Continue = Job->Handler->Record(Records[n].Offset, Records[n].Value);
+      }else{
+        Job->Failed = true;
+        Continue    = Job->Handler->Error(Records[n].Offset);
+      }
+      if(!Continue){
+        Job->Stopped = true;
+        Job->Failed  = true;
+      }
     }
-    while(ReadIndex < ReadSize){
-      if(ReadBuffer[ReadIndex] < '0' || ReadBuffer[ReadIndex] > '9') break;
-      Exponent = 10.0*Exponent + (ReadBuffer[ReadIndex] - '0');
-      ReadIndex++;
+    if(Job->Ordered){
+      Job->Delivered++;
+      Lock.unlock();
+      Job->Turn.notify_all();
     }
   }
+}
+//------------------------------------------------------------------------------
 
-  if(ExponentSign)    Exponent *= -1.0;
-  if(Exponent != 0.0) Result   *= pow(10.0, Exponent);
-  if(Sign)            Result   *= -1.0;
+bool JSON_LINES::Parse(HANDLER* Handler, const char* Data, size_t Length, bool Ordered){
+  JOB Job;
+  Job.Handler   = Handler;
+  Job.Ordered   = Ordered;
+  Job.Data      = Data;
+  Job.Size      = Length;
+  Job.Position  = 0;
+  Job.Batches   = 0;
+  Job.Delivered = 0;
+  Job.Stopped   = false;
+  Job.Failed    = false;
+
+  // The calling thread is one of the workers
+  std::vector<std::thread> Pool;
+  for(unsigned n = 1; n < Threads && n*BatchSize < Length; n++){
+    Pool.emplace_back(&JSON_LINES::Work, this, &Job);
+  }
+  Work(&Job);
+  for(size_t n = 0; n < Pool.size(); n++) Pool[n].join();
 
-  *Value = Result;
-  return true;
+  return !Job.Failed;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadObject(JSON* ObjectList){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
+bool JSON_LINES::ParseFile(HANDLER* Handler, const char* Filename, bool Ordered){
+  FILE_WRAPPER File;
+  uint64_t     Size;
 
-  if(ReadBuffer[ReadIndex] != '{') return false;
-  ReadIndex++;
+  const char* Buffer = (const char*)File.Map(Filename, &Size);
+  if(!Buffer){
+    error("Cannot map JSON file \"%s\"", Filename);
+    return false;
+  }
+  return Parse(Handler, Buffer, Size, Ordered);
+}
+//------------------------------------------------------------------------------
 
-  ObjectList->Clear();
-  ObjectList->Type = typeObject;
+struct JSON_KEYS::SHARD{
+  struct ENTRY{
+    const char* Name; // Null when the slot is empty
+    uint32_t    Length;
+    uint32_t    Hash;
+  };
+  std::mutex         Lock;
+  ARENA              Storage;
+  std::vector<ENTRY> Table; // Open-addressed, at most half full
+  size_t             Count;
+
+  SHARD(): Storage(4*kiB){ Table.resize(64); Count = 0; }
+};
+//------------------------------------------------------------------------------
 
-  string Name;
+// The shard is selected by the top bits of the hash, and the slot by the
+// bottom bits, so that the two are independent
+static const unsigned ShardBits = 4;
+//------------------------------------------------------------------------------
 
-  ReadSpace();
-  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
-    ReadIndex++;
-    return true;
-  }
+JSON_KEYS::JSON_KEYS(size_t Limit){
+  Shards      = new SHARD[1 << ShardBits];
+  this->Limit = Limit >> ShardBits;
+  if(!this->Limit) this->Limit = 1;
+}
+//------------------------------------------------------------------------------
 
-  while(ReadIndex < ReadSize){
-    if(!ReadString(&Name)){
-      if(!ReadIdentifier(&Name)){
-        ReadError("String or Identifier expected");
-        return false;
-      }
-    }
-    ReadSpace();
-    if(ReadBuffer[ReadIndex] != ':'){
-      ReadError("\":\" expected");
-      return false;
-    }
-    ReadIndex++;
-    if(ReadIndex >= ReadSize){
-      ReadError("Incomplete object");
-      return false;
+JSON_KEYS::~JSON_KEYS(){
+  delete[] Shards;
+}
+//------------------------------------------------------------------------------
+
+const char* JSON_KEYS::Intern(const char* Name, size_t Length){
+  if(Length > UINT32_MAX) return 0;
+
+  uint32_t Hash  = JSON::OBJECTS::Hash(Name, Length);
+  SHARD*   Shard = &Shards[Hash >> (32 - ShardBits)];
+
+  std::lock_guard<std::mutex> Lock(Shard->Lock);
+
+  size_t Mask = Shard->Table.size() - 1;
+  size_t Slot = Hash & Mask;
+  for(; Shard->Table[Slot].Name; Slot = (Slot + 1) & Mask){
+    SHARD::ENTRY* Entry = &Shard->Table[Slot];
+    if(Entry->Hash == Hash && Entry->Length == Length && !memcmp(Entry->Name, Name, Length)){
+      return Entry->Name;
     }
-    if(!ReadValue(ObjectList->AddOrUpdate(Name.c_str()))){
-      ReadError("Value expected");
-      return false;
+  }
+  if(Shard->Count >= Limit) return 0;
+
+  char* Copy = (char*)Shard->Storage.Allocate(Length + 1, 1);
+  memcpy(Copy, Name, Length);
+  Copy[Length] = 0;
+
+  SHARD::ENTRY Entry = {Copy, (uint32_t)Length, Hash};
+  Shard->Table[Slot] = Entry;
+  Shard->Count++;
+
+  if(2*Shard->Count > Shard->Table.size()){
+    std::vector<SHARD::ENTRY> Table(2*Shard->Table.size());
+    Mask = Table.size() - 1;
+    for(size_t n = 0; n < Shard->Table.size(); n++){
+      if(!Shard->Table[n].Name) continue;
+      for(Slot = Shard->Table[n].Hash & Mask; Table[Slot].Name; Slot = (Slot + 1) & Mask);
+      Table[Slot] = Shard->Table[n];
     }
-    ReadSpace();
-    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
-      ReadIndex++;
+    Shard->Table.swap(Table);
+  }
+  return Copy;
+}
+//------------------------------------------------------------------------------
+
+size_t JSON_KEYS::Count(){
+  size_t Result = 0;
+  for(unsigned n = 0; n < (1u << ShardBits); n++){
+    std::lock_guard<std::mutex> Lock(Shards[n].Lock);
+    Result += Shards[n].Count;
+  }
+  return Result;
+}
+//------------------------------------------------------------------------------
+
+const size_t JSON_INDEX::NotFound;
+//------------------------------------------------------------------------------
+
+class JSON_INDEX::OUTLINE: public JSON_HANDLER{
+  public:
+    JSON_INDEX* Index;
+    bool        Keys;
+
+    bool Key(const char* Name, size_t Length){
+      if(Keys) Index->Keys.emplace_back(Name, Length);
       return true;
     }
-    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ','){
-      ReadError("\",\" expected");
-      return false;
-    }
-    ReadIndex++;
-    ReadSpace();
-    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == '}'){
-      ReadIndex++;
+
+    bool Deferred(const char* Json, size_t Length){
+      ENTRY Entry;
+      Entry.Offset = (uint64_t)(Json - Index->Data);
+      Entry.Length = Length;
+      Index->Entries.push_back(Entry);
       return true;
     }
+};
+//------------------------------------------------------------------------------
+
+// Layout of the index file, which is followed by the entries and then, when
+// member names are indexed, by each name's length (uint32_t) and text
+struct JSON_INDEX_HEADER{
+  char     Magic[8];    // "JSONIDX" and a version number
+  uint64_t Size;        // Of the JSON file...
+  uint64_t Modified;    // ...its time stamp...
+  uint64_t Fingerprint; // ...and a hash of its first and last 4 kiB
+  uint64_t Count;       // Entries
+  uint64_t Keys;        // 0, or "Count" member names
+};
+static const char IndexMagic[8] = {'J', 'S', 'O', 'N', 'I', 'D', 'X', '2'};
+//------------------------------------------------------------------------------
+
+// Changes that keep the size and time stamp (within its resolution) are
+// still found if they are near either end of the file
+static uint64_t Fingerprint(const char* Data, uint64_t Size){
+  uint64_t Head = Size < 4*kiB ? Size : 4*kiB;
+  uint64_t Tail = Size - Head < 4*kiB ? Size - Head : 4*kiB;
+
+  uint64_t Hash = 0xCBF29CE484222325; // 64-bit FNV-1a
+  for(uint64_t n = 0; n < Head; n++){
+    Hash ^= (uint8_t)Data[n];
+    Hash *= 0x100000001B3;
   }
-  ReadError("Incomplete object");
-  return false;
+  for(uint64_t n = Size - Tail; n < Size; n++){
+    Hash ^= (uint8_t)Data[n];
+    Hash *= 0x100000001B3;
+  }
+  return Hash;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadArray(JSON* ObjectList){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
+static uint64_t GetModified(const char* Filename){
+  FILE_WRAPPER File;
+  if(!File.Open(Filename, FILE_WRAPPER::faRead)) return 0;
+
+  #ifdef WINVER
+    FILETIME Creation, Access, Modified = {0, 0};
+    File.GetTime(&Creation, &Access, &Modified);
+    return ((uint64_t)Modified.dwHighDateTime << 32) | Modified.dwLowDateTime;
+  #else
+    time_t StatusChange, Access, Modified = 0;
+    File.GetTime(&StatusChange, &Access, &Modified);
+    return (uint64_t)Modified;
+  #endif
+}
+//------------------------------------------------------------------------------
 
-  if(ReadBuffer[ReadIndex] != '[') return false;
-  ReadIndex++;
+JSON_INDEX::JSON_INDEX(){
+  File     = new FILE_WRAPPER;
+  Data     = 0;
+  Size     = 0;
+  Modified = 0;
+}
+//------------------------------------------------------------------------------
 
-  ObjectList->Clear();
-  ObjectList->Type = typeArray;
+JSON_INDEX::~JSON_INDEX(){
+  delete File;
+}
+//------------------------------------------------------------------------------
+
+void JSON_INDEX::Close(){
+  File->Unmap();
+  Data     = 0;
+  Size     = 0;
+  Modified = 0;
+  Entries.clear();
+  Keys   .clear();
+  Slots  .clear();
+}
+//------------------------------------------------------------------------------
 
-  JSON Value;
+bool JSON_INDEX::Map(const char* Filename){
+  Close();
 
-  ReadSpace();
-  if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
-    ReadIndex++;
-    return true;
+  // Before mapping, so that a change while mapping makes the index stale
+  Modified = GetModified(Filename);
+
+  Data = (const char*)File->Map(Filename, &Size);
+  if(!Data){
+    error("Cannot map JSON file \"%s\"", Filename);
+    return false;
   }
+  return true;
+}
+//------------------------------------------------------------------------------
 
-  while(ReadIndex < ReadSize){
-    if(!ReadValue(&Value)){
-      ReadError("Value expected");
-      return false;
-    }
-    ObjectList->Append(Value);
-    ReadSpace();
-    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
-      ReadIndex++;
-      return true;
-    }
-    ReadSpace();
-    if(ReadIndex >= ReadSize || ReadBuffer[ReadIndex] != ','){
-      ReadError("\",\" expected");
-      return false;
-    }
-    ReadIndex++;
-    ReadSpace();
-    if(ReadIndex < ReadSize && ReadBuffer[ReadIndex] == ']'){
-      ReadIndex++;
-      return true;
-    }
+void JSON_INDEX::MakeSlots(){
+  if(Keys.empty()) return;
+
+  size_t Mask = 1;
+  while(Mask < 2*Keys.size()) Mask *= 2;
+  Mask--;
+  Slots.assign(Mask+1, NotFound);
+
+  for(size_t n = 0; n < Keys.size(); n++){
+    size_t Slot = JSON::OBJECTS::Hash(Keys[n].data(), Keys[n].length()) & Mask;
+    while(Slots[Slot] != NotFound) Slot = (Slot + 1) & Mask;
+    Slots[Slot] = n;
   }
-  ReadError("Incomplete object");
-  return false;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::ReadValue(JSON* Value){
-  ReadSpace();
-  if(ReadIndex >= ReadSize) return false;
+bool JSON_INDEX::Build(const char* Filename, bool Keys){
+  if(!Map(Filename)) return false;
 
-  if(ReadString(Value)) return true;
-  if(ReadNumber(Value)) return true;
-  if(ReadObject(Value)) return true;
-  if(ReadArray (Value)) return true;
+  OUTLINE Outline;
+  Outline.Index = this;
+  Outline.Keys  = Keys;
 
-  if(ReadIndex+4 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "true", 4)){
-    ReadIndex += 4;
-    Value->Type = typeTrue;
-    return true;
+  JSON_READER Reader;
+  if(!Reader.Outline(&Outline, Data, Size)){
+    Close();
+    return false;
   }
-  if(ReadIndex+5 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "false", 5)){
-    ReadIndex += 5;
-    Value->Type = typeFalse;
-    return true;
+  MakeSlots();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_INDEX::Save(const char* IndexName) const{
+  JSON_INDEX_HEADER Header;
+  memcpy(Header.Magic, IndexMagic, sizeof(Header.Magic));
+  Header.Size        = Size;
+  Header.Modified    = Modified;
+  Header.Fingerprint = Fingerprint(Data, Size);
+  Header.Count       = Entries.size();
+  Header.Keys        = Keys.size();
+
+  std::string Buffer((const char*)&Header, sizeof(Header));
+  Buffer.append((const char*)Entries.data(), Entries.size() * sizeof(ENTRY));
+  for(size_t n = 0; n < Keys.size(); n++){
+    uint32_t Length = (uint32_t)Keys[n].length();
+    Buffer.append((const char*)&Length, sizeof(Length));
+    Buffer.append(Keys[n]);
   }
-  if(ReadIndex+4 <= ReadSize && !strncmp(ReadBuffer+ReadIndex, "null", 4)){
-    ReadIndex += 4;
-    Value->Type = typeNull;
-    return true;
+
+  FILE_WRAPPER Index;
+  if(!Index.Open(IndexName, FILE_WRAPPER::faCreate)){
+    error("Cannot create JSON index \"%s\"", IndexName);
+    return false;
   }
-  return false;
+  if(Index.Write(Buffer.data(), Buffer.size()) != Buffer.size()){
+    error("Cannot write JSON index \"%s\"", IndexName);
+    return false;
+  }
+  return true;
 }
 //------------------------------------------------------------------------------
 
-bool JSON::Parse(const char* json, unsigned Length){
-  Clear();
-
-  if(Length) ReadSize = Length;
-  else       ReadSize = strlen(json);
+bool JSON_INDEX::Load(const char* Filename, const char* IndexName){
+  FILE_WRAPPER Index;
+  uint64_t     Length;
+  const char*  Buffer = (const char*)Index.Map(IndexName, &Length);
+  if(!Buffer) return false;
+
+  JSON_INDEX_HEADER Header;
+  if(Length < sizeof(Header)) return false;
+  memcpy(&Header, Buffer, sizeof(Header));
+  if(memcmp(Header.Magic, IndexMagic, sizeof(Header.Magic))) return false;
+  if(Header.Keys && Header.Keys != Header.Count) return false;
+  if(Header.Count > (Length - sizeof(Header)) / sizeof(ENTRY)) return false;
+
+  if(!Map(Filename)) return false;
+  if(
+    Size     != Header.Size     ||
+    Modified != Header.Modified ||
+    Fingerprint(Data, Size) != Header.Fingerprint
+  ){
+    Close();
+    return false;
+  }
 
-  ReadLine   = 1;
-  ReadIndex  = 0;
-  ReadBuffer = json;
+  const char* Read = Buffer + sizeof(Header);
+  const char* End  = Buffer + Length;
+  Entries.resize(Header.Count);
+  memcpy(Entries.data(), Read, Entries.size() * sizeof(ENTRY));
+  Read += Entries.size() * sizeof(ENTRY);
 
-  if(!ReadValue(this)){
-    ReadError("Cannot parse JSON file");
-    return false;
+  for(size_t n = 0; n < Entries.size(); n++){
+    if(Entries[n].Offset > Size || Entries[n].Length > Size - Entries[n].Offset){
+      Close();
+      return false;
+    }
+  }
+  Keys.resize(Header.Keys);
+  for(size_t n = 0; n < Keys.size(); n++){
+    uint32_t KeyLength;
+    if((size_t)(End - Read) < sizeof(KeyLength)){
+      Close();
+      return false;
+    }
+    memcpy(&KeyLength, Read, sizeof(KeyLength));
+    Read += sizeof(KeyLength);
+    if((size_t)(End - Read) < KeyLength){
+      Close();
+      return false;
+    }
+    Keys[n].assign(Read, KeyLength);
+    Read += KeyLength;
   }
+  MakeSlots();
   return true;
 }
 //------------------------------------------------------------------------------
 
-const char* JSON::Stringify(){
-  int  n, N;
-  char s[0x100];
+bool JSON_INDEX::Open(const char* Filename, const char* IndexName){
+  std::string Default;
+  if(!IndexName){
+    Default   = Filename;
+    Default  += ".idx";
+    IndexName = Default.c_str();
+  }
+  if(Load(Filename, IndexName)) return true;
+  if(!Build(Filename)) return false;
+  Save(IndexName); // The index is still usable if it cannot be saved
+  return true;
+}
+//------------------------------------------------------------------------------
 
-  switch(Type){
-    case typeNull:
-      Stringification = "null";
-      break;
+size_t JSON_INDEX::GetCount() const{
+  return Entries.size();
+}
+//------------------------------------------------------------------------------
 
-    case typeTrue:
-      Stringification = "true";
-      break;
+const char* JSON_INDEX::GetText(size_t Index, size_t* Length) const{
+  if(Index >= Entries.size()) return 0;
+  *Length = Entries[Index].Length;
+  return Data + Entries[Index].Offset;
+}
+//------------------------------------------------------------------------------
 
-    case typeFalse:
-      Stringification = "false";
-      break;
+bool JSON_INDEX::Get(size_t Index, JSON* Value, unsigned Flags) const{
+  size_t      Length;
+  const char* Text = GetText(Index, &Length);
+  if(!Text){
+    Value->Clear();
+    return false;
+  }
+  return Value->Parse(Text, Length, Flags);
+}
+//------------------------------------------------------------------------------
 
-    case typeString:
-      Stringification  = '"';
-      for(n = 0; String[n]; n++){
-        switch(String[n]){
-          case  '"': Stringification += "\\\""   ; break;
-          case '\\': Stringification += "\\\\"   ; break;
-          case  '/': Stringification += "\\/"    ; break;
-          case '\b': Stringification += "\\b"    ; break;
-          case '\f': Stringification += "\\f"    ; break;
-          case '\n': Stringification += "\\n"    ; break;
-          case '\r': Stringification += "\\r"    ; break;
-          case '\t': Stringification += "\\t"    ; break;
-          default  : Stringification += String[n]; break;
-        }
-      }
-      Stringification += '"';
-      break;
+bool JSON_INDEX::Get(size_t Index, JSON_HANDLER* Handler, unsigned Features) const{
+  size_t      Length;
+  const char* Text = GetText(Index, &Length);
+  if(!Text) return false;
 
-    case typeNumber:
-      sprintf(s, "%.14g", Number);
-      Stringification = s;
-      break;
+  JSON_READER Reader;
+  Reader.SetFeatures(Features);
+  return Reader.Parse(Handler, Text, Length);
+}
+//------------------------------------------------------------------------------
 
-    case typeObject:
-      Stringification = '{';
-      n = 0;
-      N = Objects.size();
-      for(
-        auto Object = Objects.begin();
-        Object != Objects.end();
-        Object++
-      ){
-        Stringification += '"';
-        Stringification += Object->first;
-        Stringification += '"';
-        Stringification += ':';
-        Stringification += Object->second->Stringify();
-        n++;
-        if(n < N) Stringification += ",";
-      }
-      Stringification += '}';
-      break;
+const char* JSON_INDEX::GetKey(size_t Index) const{
+  if(Index >= Keys.size()) return 0;
+  return Keys[Index].c_str();
+}
+//------------------------------------------------------------------------------
 
-    case typeArray:
-      Stringification = "[";
-      for(size_t n = 0; n < Items.size(); n++){
-        Stringification += Items[n]->Stringify();
-        if(n < Items.size()-1) Stringification += ",";
-      }
-      Stringification += "]";
-      break;
+size_t JSON_INDEX::Find(const char* Name, size_t Length) const{
+  if(Slots.empty()) return NotFound;
+  if(!Length) Length = strlen(Name);
 
-    default:
-      break;
+  size_t Mask = Slots.size() - 1;
+  for(size_t Slot = JSON::OBJECTS::Hash(Name, Length) & Mask;; Slot = (Slot + 1) & Mask){
+    size_t n = Slots[Slot];
+    if(n == NotFound) return NotFound;
+    if(Keys[n].length() == Length && !memcmp(Keys[n].data(), Name, Length)) return n;
   }
-  return Stringification.c_str();
 }
 //------------------------------------------------------------------------------
-
@@ -13,15 +13,356 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define JSON_h
 //------------------------------------------------------------------------------
 
-#include <map>
 #include <string>
 #include <vector>
 //------------------------------------------------------------------------------
 
+#include "Arena.h"
 #include "General.h"
 //------------------------------------------------------------------------------
 
+class FILE_WRAPPER;
+class JSON_KEYS;
+//------------------------------------------------------------------------------
+
+// Receives the events of an event-driven (SAX) parse.  Strings and keys are
+// only valid for the duration of the call, unless they point into an in-situ
+// buffer.  Returning false stops the parse.
+class JSON_HANDLER{
+  public:
+    virtual ~JSON_HANDLER(){}
+
+    virtual bool Null  ()                                   { return true; }
+    virtual bool Bool  (bool        Value)                  { return true; }
+    virtual bool Number(double      Value)                  { return true; }
+    virtual bool String(const char* Value, size_t Length)   { return true; }
+
+    // Integral literals that fit in 64 bits.  By default they are reported
+    // as a Number, rounded to the nearest double.
+    virtual bool Integer (int64_t  Value){ return Number((double)Value); }
+    virtual bool Unsigned(uint64_t Value){ return Number((double)Value); }
+
+    virtual bool StartObject()                              { return true; }
+    virtual bool Key        (const char* Name, size_t Length){ return true; }
+    virtual bool EndObject  ()                              { return true; }
+
+    virtual bool StartArray()                               { return true; }
+    virtual bool EndArray  ()                               { return true; }
+
+    // Called just before StartObject or StartArray by sources that know the
+    // number of members or items up front (documents and binary readers),
+    // so that length-prefixed encodings need not patch their headers.
+    virtual bool Size(size_t Count)                         { return true; }
+
+    // Called at the start of every object or array.  Returning true skips
+    // it without parsing: the reader only finds its end, and passes the
+    // (unvalidated) source text to Deferred() instead of the events.
+    virtual bool Defer   ()                                 { return false; }
+    virtual bool Deferred(const char* Json, size_t Length)  { return true;  }
+};
+//------------------------------------------------------------------------------
+
+// Event-driven parser of JSON and JSON-5 strings.  Nothing is stored: every
+// value is reported to the handler as it is read.
+class JSON_READER{
+  public:
+    // Extensions of RFC 8259 that are accepted.  The grammar is compiled
+    // separately for the strict and JSON-5 dialects, so that neither checks
+    // for features at run time; any other combination does.
+    enum FEATURES{
+      fComments    = 0x01, // "//" and "/* */"
+      fIdentifiers = 0x02, // Unquoted keys
+      fQuotes      = 0x04, // Single-quoted strings, "\'" and escaped new-lines
+      fNumbers     = 0x08, // Infinity, NaN, hexadecimal, "+" and a bare "."
+      fTrailing    = 0x10, // Commas after the last member or item
+      fSpace       = 0x20, // Vertical tabs as white space
+      fControls    = 0x40, // Control characters other than line breaks in strings
+      fTail        = 0x80, // Text after the top-level value, which is ignored
+
+      Strict = 0,
+      JSON5  = 0xFF
+    };
+
+  private:
+    enum{ Dynamic = 0x80000000 }; // Instantiation that tests "Features"
+
+    JSON_HANDLER* Handler;
+    unsigned      Features;
+
+    const char* ReadBuffer;
+    char*       ReadInSitu;  // Writable alias of ReadBuffer when parsing in-situ
+    std::string ReadScratch; // Decoding buffer for strings that are not in-situ
+    size_t      ReadLine;
+    size_t      ReadSize;
+    size_t      ReadIndex;
+    bool        Stopped;     // The handler asked to stop
+
+    bool Stop();
+
+    // "F" is a combination of FEATURES, or "Dynamic"
+    template<unsigned F> bool Allows(unsigned Feature) const{
+      return (F & Dynamic) ? (Features & Feature) : (F & Feature);
+    }
+
+    void ReadError(const char* Message);
+    template<unsigned F> void ReadSpace();
+    template<unsigned F> void SkipSpace();
+    void ReadLineComment();
+    void ReadBlockComment();
+
+    // Skips string content that needs no decoding, and validates its UTF-8
+    template<unsigned F> bool ReadPlain(char Quote);
+
+    bool ReadCodeUnit       (uint32_t* Result); // \uXXXX, from the 'u'
+    bool ReadUnicodeSequence(std::string* String);
+    bool ReadIdentifierStart(std::string* String);
+    bool ReadIdentifierPart (std::string* String);
+
+    // The result is only valid until the next string is read.  Identifiers
+    // are only tried after ReadString(), which skips the leading space.
+    bool                 ReadIdentifier(const char** Value, size_t* Length);
+    template<unsigned F> bool ReadString(const char** Value, size_t* Length);
+
+    // Numbers are reported to the handler directly, as an integer where
+    // the literal allows it
+    bool                 ReadHexadecimal(bool Sign);
+    template<unsigned F> bool ReadNumber();
+    template<unsigned F> bool ReadObject();
+    template<unsigned F> bool ReadArray ();
+    bool                 ReadDeferred   ();
+    template<unsigned F> bool ReadValue ();
+    template<unsigned F> bool ReadOutline();
+
+    bool Parse(JSON_HANDLER* Handler, const char* json, char* InSitu, size_t Length);
+
+    // Used by JSON_STREAM to decode one complete token: a key, or a string,
+    // number or literal value
+    friend class JSON_STREAM;
+    bool ReadToken(
+      JSON_HANDLER* Handler,
+      const char*   Token,
+      size_t        Length,
+      size_t        Line,
+      bool          Key
+    );
+
+  public:
+    JSON_READER();
+
+    // "Features" is a combination of FEATURES; the default is JSON5
+    void     SetFeatures(unsigned Features);
+    unsigned GetFeatures() const;
+
+    // If "Length" is 0, "strlen" is used to determine the length
+    bool Parse(JSON_HANDLER* Handler, const char* json, size_t Length = 0);
+
+    // Decodes strings in place, so that the strings passed to the handler
+    // remain valid for as long as the (modified) buffer does
+    bool ParseInSitu(JSON_HANDLER* Handler, char* json, size_t Length = 0);
+
+    // True when "String" points into the in-situ buffer of the current parse
+    bool IsInSitu(const char* String);
+
+    // After a parse: true if only space (and comments, where allowed)
+    // follows the value
+    bool AtEnd();
+
+    // Reports the members or items of the top-level object or array without
+    // parsing them: member names are passed to Key(), and the source text of
+    // every value to Deferred().  Nested objects and arrays are only matched
+    // by brackets, as when the handler defers them.
+    bool Outline(JSON_HANDLER* Handler, const char* json, size_t Length = 0);
+};
+//------------------------------------------------------------------------------
+
+// Serialises the events it receives in a single pass, so that it can be
+// driven by a document (JSON::Emit), by JSON_READER (to reformat a file) or
+// by the caller directly.  A sequence of top-level values is written one
+// per line.
+class JSON_WRITER: public JSON_HANDLER{
+  private:
+    char*         Buffer;
+    size_t        Capacity; // Usable bytes, excluding the null-terminator
+    size_t        Used;     // Bytes currently in the buffer
+    size_t        Total;    // Bytes produced, including flushed or dropped
+    bool          Growable; // The buffer is owned and reallocated as needed
+    FILE_WRAPPER* File;     // Sink for the buffer contents, if any
+    bool          Failed;   // Write error, or output did not fit
+
+    int               Indent;   // Spaces per level; 0 for compact output
+    std::vector<bool> Stack;    // "First" of the enclosing containers
+    bool              First;    // No values in the current container yet
+    bool              AfterKey;
+
+    void Init      (int Indent);
+    bool MakeRoom  (size_t Length);
+    void Write     (const char* Data, size_t Length);
+    void Write     (char Char);
+    void NewLine   ();
+    void BeginValue();
+    void WriteString(const char* Value, size_t Length);
+
+  public:
+    JSON_WRITER(int Indent = 0);                            // Growable buffer
+    JSON_WRITER(char* Buffer, size_t Size, int Indent = 0); // Fixed buffer
+    JSON_WRITER(FILE_WRAPPER* File, int Indent = 0);        // Open file
+   ~JSON_WRITER();
+    JSON_WRITER(const JSON_WRITER&) = delete;
+    JSON_WRITER& operator= (const JSON_WRITER&) = delete;
+
+    // The null-terminated output so far (not for file output)
+    const char* GetBuffer();
+
+    // The length of the complete output, even if it did not fit
+    size_t GetLength();
+
+    // Writes the remaining buffer to the file.  Returns false if anything
+    // could not be written (or, for a fixed buffer, did not fit).
+    bool Flush();
+
+    bool Null  ();
+    bool Bool  (bool        Value);
+    bool Number(double      Value);
+    bool String(const char* Value, size_t Length);
+
+    bool Integer (int64_t  Value);
+    bool Unsigned(uint64_t Value);
+
+    bool StartObject();
+    bool Key        (const char* Name, size_t Length);
+    bool EndObject  ();
+
+    bool StartArray();
+    bool EndArray  ();
+
+    // Writes a value that is already serialised, with the same indentation
+    bool Raw(const char* Json, size_t Length);
+
+    // Output in pieces: a writer that Continue()s inside "Depth" open
+    // containers writes values exactly as they would appear there (after
+    // others, unless "First"), so that its output can be Insert()ed into
+    // the innermost container of another writer.
+    void Continue(size_t Depth, bool First);
+    bool Insert  (const char* Json, size_t Length);
+};
+//------------------------------------------------------------------------------
+
+// Thread safety: a document that no thread modifies can be read by any
+// number of threads at once through the const interface (the const
+// operator[], iteration of Objects and Items, the accessors, Emit() and the
+// const Stringify() overloads), which keeps no state in the nodes.  The
+// non-const Stringify(Indent) stores its result in the document, and the
+// non-const look-ups parse lazy containers (see "pfLazy"), so neither may
+// be used concurrently.
 class JSON{
+  public: // Storage types
+    // Immutable string value.  Short values are stored inline, longer ones
+    // on the heap or in the document arena, and in-situ parsing makes it
+    // refer directly to the parse buffer.  Copies are independent of the
+    // source document.
+    class STRING{
+      public:
+        static const size_t LocalSize = 16; // Longer values are allocated
+
+      private:
+        enum STATE{ sLocal, sHeap, sArena, sView };
+
+        const char* Data; // Always valid and null-terminated
+        size_t      Length;
+        STATE       State;
+        char        Local[LocalSize];
+
+        void Release();
+
+      public:
+        STRING();
+        STRING(const STRING&  Value);
+        STRING(      STRING&& Value) noexcept;
+       ~STRING();
+
+        STRING& operator= (const STRING& Value);
+        STRING& operator= (const char*   Value);
+
+        // Copies the value; into the arena if one is provided
+        void Assign(const char* Value, size_t Length, ARENA* Arena = 0);
+
+        // Refers to the value without copying.  It must be null-terminated
+        // and outlive this string.
+        void View(const char* Value, size_t Length);
+
+        const char* c_str () const{ return Data;        }
+        const char* data  () const{ return Data;        }
+        size_t      length() const{ return Length;      }
+        size_t      size  () const{ return Length;      }
+        bool        empty () const{ return !Length;     }
+        char operator[] (size_t Index) const{ return Data[Index]; }
+
+        bool operator<  (const STRING& Value) const;
+        bool operator== (const STRING& Value) const;
+        bool operator== (const char*   Value) const;
+        bool operator!= (const STRING& Value) const{ return !operator==(Value); }
+        bool operator!= (const char*   Value) const{ return !operator==(Value); }
+    };
+
+    // Containers are allocated from the document arena when parsed with
+    // "pfArena", or from the global heap otherwise
+
+    typedef std::pair<STRING, JSON*> MEMBER;
+
+    // Object members, in insertion order.  Small objects are searched
+    // linearly; larger ones also keep an open-addressed hash index into
+    // the member list.
+    class OBJECTS{
+      public:
+        typedef       MEMBER*       iterator;
+        typedef const MEMBER* const_iterator;
+
+      private:
+        std::vector<MEMBER,   ARENA_ALLOCATOR<MEMBER  >> Members;
+        std::vector<uint32_t, ARENA_ALLOCATOR<uint32_t>> Index; // Member + 1; 0 when empty
+
+        void     Insert(uint32_t Member);
+        void     Rehash();
+        iterator Scan  (const char* Name, size_t Length);
+
+      public:
+        OBJECTS(ARENA* Arena = 0);
+        OBJECTS(OBJECTS&&) = default;
+        OBJECTS(const OBJECTS&) = delete;
+        OBJECTS& operator= (const OBJECTS&) = delete;
+
+        iterator       begin()      { return Members.data(); }
+        iterator       end  ()      { return Members.data() + Members.size(); }
+        const_iterator begin() const{ return Members.data(); }
+        const_iterator end  () const{ return Members.data() + Members.size(); }
+
+        size_t size () const{ return Members.size();  }
+        bool   empty() const{ return Members.empty(); }
+
+        // Hash of a key, so that repeated look-ups can compute it only once
+        static uint32_t Hash(const char* Name, size_t Length);
+
+        // Returns end() when the key does not exist
+        iterator find(const char* Name, size_t Length);
+        iterator find(const char* Name, size_t Length, uint32_t Hash);
+        iterator find(const char* Name){ return find(Name, strlen(Name)); }
+
+        // Look-ups do not modify the object
+        const_iterator find(const char* Name, size_t Length) const{
+          return const_cast<OBJECTS*>(this)->find(Name, Length);
+        }
+        const_iterator find(const char* Name, size_t Length, uint32_t Hash) const{
+          return const_cast<OBJECTS*>(this)->find(Name, Length, Hash);
+        }
+        const_iterator find(const char* Name) const{ return find(Name, strlen(Name)); }
+
+        // Appends a member, without checking for an existing key
+        void emplace(STRING&& Name, JSON* Value);
+    };
+
+    typedef std::vector<JSON*, ARENA_ALLOCATOR<JSON*>> ITEMS;
+//------------------------------------------------------------------------------
+
   public: // Object type
     enum TYPE{
       typeNull  , typeTrue, typeFalse,
@@ -30,109 +371,636 @@ class JSON{
     } Type;
 //------------------------------------------------------------------------------
 
+  public: // Value
+    double Number; // Also valid for integers, but possibly rounded
+
+    // Only the member that matches "Type" exists, so that a node is not much
+    // larger than its largest container
+    union{
+      STRING  String;  // typeString
+      OBJECTS Objects; // typeObject
+      ITEMS   Items;   // typeArray
+    };
+//------------------------------------------------------------------------------
+
   public: // Base types
-    std::string String;
-    double      Number;
+    // Integers are kept exactly as long as they fit in 64 bits, whereas
+    // "Number" only holds them exactly up to 53 bits
+    bool     IsInt64  () const;
+    bool     IsUint64 () const;
+    int64_t  GetInt64 () const; // Exact only when IsInt64 ()
+    uint64_t GetUint64() const; // Exact only when IsUint64()
 
     // These functions make copies of the value
     void operator=(const char* Value);
     void operator=(int         Value);
     void operator=(unsigned    Value);
+    void operator=(int64_t     Value);
+    void operator=(uint64_t    Value);
     void operator=(double      Value);
     void operator=(bool        Value);
 //------------------------------------------------------------------------------
 
   public: // Object-related functions
-    std::map<std::string, JSON*> Objects;
+    // From now on, keys that would otherwise be allocated (those of at least
+    // STRING::LocalSize bytes, when not parsed in-situ) are stored once in
+    // "Keys" and shared by all documents, in all threads.  The table must
+    // outlive every document that uses it.  Null turns interning off.
+    static void InternKeys(JSON_KEYS* Keys);
 
     // Adds a new key-value pair, or updates the existing
     // - If "Value" is "typeObject", the update is recursive (i.e. old
     //   values are not deleted, while new ones are added or updated)
-    // - These functions make copies of the value.
+    // - These functions make copies of the value, except for the rvalue
+    //   versions, which take over the subtree where they can (see "Moves").
     // - Returns the JSON object containing the value.
     // - If no "Value" is provided, it either creates a new object with
     //   value "null", or returns the value of the current object.
     // - If no "Name" is provided, the update operation is on the root object
     JSON* AddOrUpdate(                  JSON&       Value);
+    JSON* AddOrUpdate(                  JSON&&      Value);
     JSON* AddOrUpdate(const char* Name, JSON&       Value);
+    JSON* AddOrUpdate(const char* Name, JSON&&      Value);
     JSON* AddOrUpdate(const char* Name, const char* Value);
     JSON* AddOrUpdate(const char* Name, int         Value);
     JSON* AddOrUpdate(const char* Name, unsigned    Value);
+    JSON* AddOrUpdate(const char* Name, int64_t     Value);
+    JSON* AddOrUpdate(const char* Name, uint64_t    Value);
     JSON* AddOrUpdate(const char* Name, double      Value);
     JSON* AddOrUpdate(const char* Name, bool        Value);
     JSON* AddOrUpdate(const char* Name);
 
     // Cannot return a reference, because it could be null (i.e. not in the list)
     JSON* operator[] (const char* Name);
+
+    // Does not parse a lazy object, so that it returns null until the object
+    // is materialised
+    const JSON* operator[] (const char* Name) const;
 //------------------------------------------------------------------------------
 
   public: // Array-related functions
-    std::vector<JSON*> Items;
-
-    // These functions make copies of the value
+    // These functions make copies of the value, except for the rvalue version
     // If the type is not "null" and not "Array", the current value becomes
     // the first item of the array and the provided "Value" the second.
     void Append(JSON&       Value);
+    void Append(JSON&&      Value);
     void Append(const char* Value);
     void Append(int         Value);
     void Append(unsigned    Value);
+    void Append(int64_t     Value);
+    void Append(uint64_t    Value);
     void Append(double      Value);
     void Append(bool        Value);
 
     // Cannot return a reference, because it could be null (i.e. not in the array)
     JSON* operator[] (int Index);
+
+    // Does not parse a lazy array or unpack a packed one, so that it returns
+    // null until the array is materialised
+    const JSON* operator[] (int Index) const;
 //------------------------------------------------------------------------------
 
   private: // Private stuff
-    std::string Stringification; // Used to return from Stringify()
+    // Exact representation of "Number", if it is integral
+    enum INTEGER{ intNone, intSigned, intUnsigned } Integer;
+
+    // Incremental Stringify(): every object and array remembers where its
+    // text is in the previous output of the root, relative to its parent,
+    // and mutations mark the path to the root as changed.  Unchanged
+    // subtrees are then copied from the previous output.
+    uint32_t CacheOffset; // From the start of the parent's text
+    uint32_t CacheLength;
+    bool     Cached;      // CacheOffset and CacheLength are valid
+    bool     Clean;       // Not changed since the previous output
+    JSON*    Parent;
+
+    // "Previous" is the text of this node in the previous output, or null
+    // Returns false if a lazy value could not be parsed
+    bool Serialise(JSON_WRITER* Writer, const char* Previous, size_t ParentStart);
+
+    // Parallel serialisation: the items of the last container on "Path" are
+    // split into chunks, which are written on separate threads
+    bool Emit    (JSON_WRITER* Writer, int Indent, unsigned Threads) const;
+    bool EmitPath(
+      JSON_WRITER*                    Writer,
+      const std::vector<const JSON*>& Path,
+      size_t                          Level, // Of this node on the path
+      const std::vector<std::string>& Chunks
+    ) const;
+
+    // An object or array that is not built yet: the source text of a lazy
+    // value (pfLazy), or the numbers of a packed array (pfPacked)
+    enum PACKING{ pkText, pkInt64, pkDouble };
+    struct SPAN{
+      char*   Data;    // Text, or an array of int64_t or double
+      size_t  Length;  // Bytes of text, or the number of items
+      PACKING Packing;
+      bool    Pack;     // Text: pack the numeric arrays in it when parsed
+      uint8_t Features; // Text: JSON_READER::FEATURES of the dialect
+    };
+
+    union{
+      int64_t  Signed;   // intSigned: any value that fits in int64_t
+      uint64_t Unsigned; // intUnsigned: only values beyond INT64_MAX
+      SPAN*    Lazy;     // typeObject, typeArray: null once parsed
+    };
+
+    // Source of all allocations for this node and its children: null when
+    // using the heap.  Nodes in an arena are never deleted individually.
+    ARENA* Arena;
+
+    // State that few nodes need (usually only the root of a document), so
+    // that it is only allocated on demand
+    struct DOCUMENT{
+      STRING Stringification; // Used to return from Stringify()
+      int    Indent;          // Of the Stringification
+      char*  Buffer;          // In-situ parse buffer, when copied to the heap
+      ARENA* Arena;           // Owned by the root of an arena document
+
+      DOCUMENT(){ Indent = 0; Buffer = 0; Arena = 0; }
+    };
+    DOCUMENT* Document;
+
+    JSON (ARENA* Arena);
+    void      Init       (ARENA* Arena);
+    void      Reset      (); // Like Clear(), but keeps using the current arena
+    void      SetType    (TYPE Type); // Reset() and construct the new member
+    DOCUMENT* GetDocument();
+    bool      CanMove    (JSON& Value);
+    bool      Contains   (const JSON* Node) const; // A descendant of this one
+    void      Move       (JSON& Value); // Reset() first; resets "Value"
+    JSON*     NewNode    ();
+    void      NewKey     (STRING* Key, const char* Name, size_t Length);
+    void      DeleteNode (JSON* Node);
+    JSON*     AddMember  (const char* Name, size_t Length, bool View);
+    void      AppendItem (JSON* Item);
 //------------------------------------------------------------------------------
 
   private: // Parser
-    const char* ReadBuffer;
-    unsigned    ReadLine;
-    unsigned    ReadSize;
-    unsigned    ReadIndex;
+    friend class JSON_STREAM;
+    friend class JSON_POINTER;
+    friend class JSON_LINES;
+    friend class BINARY_READER;
 
-    void ReadError(const char* Message);
-    void ReadSpace();
-    void ReadLineComment();
-    void ReadBlockComment();
+    // Builds the tree from the JSON_READER events
+    class BUILDER: public JSON_HANDLER{
+      private:
+        JSON*              Root;
+        JSON*              Member; // Value of the most recent key
+        JSON_READER*       Reader;
+        std::vector<JSON*> Stack;  // Open objects and arrays
+        bool               Lazy;   // Nested containers are left unparsed
+        bool               Pack;   // Numeric arrays are packed
 
-    bool ReadUnicodeSequence(std::string* String);
-    bool ReadIdentifierStart(std::string* String);
-    bool ReadIdentifierPart (std::string* String);
+        // Numbers of the innermost open array, while it only contains
+        // numbers that can be packed
+        struct NUMBER{
+          double  Value;
+          int64_t Integer;
+          bool    IsInteger;
+        };
+        JSON*               Packing; // Null when not packing
+        std::vector<NUMBER> Numbers;
+
+        JSON* NewValue();
+        void  Unpack  (); // Adds the numbers as nodes, and stops packing
+
+      public:
+        BUILDER(JSON* Root, JSON_READER* Reader, bool Lazy = false, bool Pack = false);
+
+        bool Null  ();
+        bool Bool  (bool        Value);
+        bool Number(double      Value);
+        bool String(const char* Value, size_t Length);
+
+        bool Integer (int64_t  Value);
+        bool Unsigned(uint64_t Value);
+
+        bool StartObject();
+        bool Key        (const char* Name, size_t Length);
+        bool EndObject  ();
+
+        bool StartArray();
+        bool EndArray  ();
 
-    bool ReadHexadecimal(JSON* Value, bool Sign);
-    bool ReadIdentifier (std::string* Value);
-    bool ReadString     (std::string* Value);
-    bool ReadString     (JSON* Value);
-    bool ReadNumber     (JSON* Value);
-    bool ReadObject     (JSON* ObjectList);
-    bool ReadArray      (JSON* ObjectList);
-    bool ReadValue      (JSON* Value);
+        bool Defer   ();
+        bool Deferred(const char* Json, size_t Length);
+    };
+
+    // Discards all previous data and sets up the allocation mode
+    void BeginParse(unsigned Flags);
+
+    // "InSitu" is either null or a writable alias of "json"
+    bool ParseBuffer(const char* json, char* InSitu, size_t Length, unsigned Flags);
 //------------------------------------------------------------------------------
 
   public:
     JSON();
     JSON(JSON&       Value);
+    JSON(JSON&&      Value);
     JSON(const char* Value);
     JSON(int         Value);
     JSON(unsigned    Value);
+    JSON(int64_t     Value);
+    JSON(uint64_t    Value);
     JSON(double      Value);
     JSON(bool        Value);
    ~JSON();
 
+    enum PARSE_FLAGS{
+      // Allocate all nodes, keys and strings of the document from a single
+      // arena, which is released in one go by Clear().  Values later added
+      // to the document are also placed in the arena, and the memory of
+      // replaced values is only recovered by the next Clear().
+      pfArena = 0x01,
+
+      // Decode strings and keys in place, so that the document refers to
+      // the parse buffer instead of copying every value.  "Parse" makes a
+      // single copy of the input for this purpose, owned by the document.
+      pfInSitu = 0x02,
+
+      // Only parse the top level: nested objects and arrays just record
+      // where they are in the (in-situ) buffer, and are parsed the first
+      // time they are looked up with operator[].  Objects or Items must not
+      // be used directly before calling Materialise().  Errors inside a
+      // nested value are only found when it is parsed.  Implies "pfInSitu".
+      pfLazy = 0x04,
+
+      // Only accept RFC 8259 JSON, without the JSON-5 extensions.  Nested
+      // values of a lazy document are parsed in the same dialect.
+      pfStrict = 0x08,
+
+      // Arrays that only contain numbers are stored as a packed vector of
+      // int64_t (when all are integers) or double, of 8 bytes per item.
+      // The numbers are available through GetPackedInt64/Double(), and
+      // nodes are only made for them when the array is materialised, as
+      // for "pfLazy".  Integers in an array of doubles then become plain
+      // numbers, for which IsInt64() is false.
+      pfPacked = 0x10
+    };
+
     // If "Length" is 0, "strlen" is used to determine the length
-    bool Parse(const char* json, unsigned Length = 0);
+    // "Flags" is a combination of PARSE_FLAGS
+    bool Parse(const char* json, size_t Length = 0, unsigned Flags = 0);
+
+    // Parses the file directly from a read-only memory map, without reading
+    // it into memory first.  "Filename" is UTF-8.
+    bool ParseFile(const char* Filename, unsigned Flags = 0);
+
+    // Parses in-situ, directly in the caller's buffer without copying it.
+    // The buffer is modified, and must outlive the document (or until the
+    // next Clear()).  Implies "pfInSitu".
+    bool ParseInSitu(char* json, size_t Length = 0, unsigned Flags = 0);
+
+    // Parses a lazy object or array (see "pfLazy"), one level deep, or
+    // unpacks a packed array (see "pfPacked").  Returns false on a parse
+    // error, in which case the value becomes "null".
+    bool Materialise();
+
+    // The numbers of a packed array that is not materialised yet, or null if
+    // the array is not packed as that type
+    const int64_t* GetPackedInt64 (size_t* Count) const;
+    const double*  GetPackedDouble(size_t* Count) const;
 
     // This function makes a copy of the contents
     void operator=(JSON& json);
 
+    // Moves: the subtree is taken over without copying when both nodes use
+    // the same allocator (the heap, or the same arena).  The move constructor
+    // also takes over the arena and parse buffer of a document root.  In
+    // other cases the contents are copied, and the source keeps them; it is
+    // only "null" when its subtree was taken over.
+    // Subtrees moved out of an in-situ document keep referring to its parse
+    // buffer.
+    void operator=(JSON&& json);
+
     // Discard all previous data
     void Clear();
 
-    // Converts to a JSON string (internal allocation, do not free)
-    const char* Stringify();
+    // Marks the node as changed, so that the next Stringify() of the root
+    // does not reuse its previous text.  All the functions of this class do
+    // so automatically, but changes made directly to Number, String, Objects
+    // or Items must be followed by a call to Touch().
+    void Touch();
+
+    // Reports the document to the handler as a sequence of events.  Returns
+    // false if the handler stopped it.
+    bool Emit(JSON_HANDLER* Handler) const;
+
+    // Converts to a JSON string (internal allocation, do not free).
+    // "Indent" is the number of spaces per level for pretty printing, or 0
+    // for compact output.  On the root of a document, objects and arrays
+    // that did not change since the previous call are copied from its
+    // output instead of being serialised again.
+    // All the overloads fail if a lazy value (see "pfLazy") cannot be
+    // parsed, instead of returning incomplete output: this one returns null.
+    const char* Stringify(int Indent = 0);
+
+    // Writes into a caller-supplied buffer, which is always null-terminated.
+    // Returns the length of the complete output: if it is not less than
+    // "Size", the output was truncated.  On failure the buffer is emptied
+    // and 0 is returned.
+    size_t Stringify(char* Buffer, size_t Size, int Indent = 0) const;
+
+    // Replaces the contents of "Result", which is emptied on failure.  The
+    // output is the same for any number of "Threads" (0 for one per
+    // processor core): they share the items of the largest object or array
+    // near the root.
+    bool Stringify(std::string* Result, int Indent = 0, unsigned Threads = 1) const;
+
+    // Writes to an open file; returns false on error
+    bool Stringify(FILE_WRAPPER* File, int Indent = 0, unsigned Threads = 1) const;
+};
+//------------------------------------------------------------------------------
+
+// Push parser for input that arrives in pieces (from a pipe, socket, etc.).
+// Chunks can be split anywhere, including inside strings, numbers and
+// comments, and the result is the same events (or tree) as a JSON_READER
+// parse of the concatenated input.
+class JSON_STREAM{
+  private:
+    enum STATE{
+      sSpace,
+      sSlash,        // Could start a comment
+      sLineComment,
+      sBlockComment,
+      sBlockStar,    // Could end a block comment
+      sString,
+      sStringEscape,
+      sWord          // Number, literal or identifier
+    } State;
+
+    enum EXPECT{
+      eValue,
+      eValueOrEnd, // Start of an array, or after a comma in an array
+      eKeyOrEnd,   // Start of an object, or after a comma in an object
+      eColon,
+      eCommaOrEnd,
+      eDone
+    } Expect;
+
+    JSON_HANDLER*  Handler;
+    JSON::BUILDER* Builder; // When parsing into a document
+    JSON_READER    Reader;  // Decodes the tokens
+
+    std::vector<bool> Stack; // Open containers: true for objects
+    std::string       Carry; // Start of a token split across chunks
+    char              Quote;
+    size_t            Line;
+    bool              Comma;  // Since the last value, for trailing commas
+    bool              Failed;
+
+    bool Stop      ();
+    bool Error     (const char* Message);
+    bool Structural(char Char);
+    bool Token     (const char* Token, size_t Length);
+    void AfterValue();
+
+  public:
+    JSON_STREAM();
+   ~JSON_STREAM();
+
+    // Starts a new parse, reporting the events to "Handler".  "Features" is a
+    // combination of JSON_READER::FEATURES.
+    void Begin(JSON_HANDLER* Handler, unsigned Features = JSON_READER::JSON5);
+
+    // Starts a new parse into "Document", which is cleared first.
+    // "Flags" is a combination of JSON::PARSE_FLAGS, except "pfInSitu" and
+    // "pfLazy", which need the whole input at once.
+    void Begin(JSON* Document, unsigned Flags = 0);
+
+    // Parses the next piece of the input.  Returns false on error, or if the
+    // handler stopped the parse.
+    bool Parse(const char* Chunk, size_t Length);
+
+    // Marks the end of the input, and returns true if a complete value
+    // has been parsed.
+    bool End();
+};
+//------------------------------------------------------------------------------
+
+// Compiled JSON Pointer (RFC 6901), e.g. "/a/b/3/c", which is parsed once and
+// can then be evaluated against any number of documents.  As an extension,
+// a "*" segment matches every member or item, and a "Start:End" segment
+// matches the array items from "Start" up to, but excluding, "End" (either
+// may be omitted).
+class JSON_POINTER{
+  private:
+    struct SEGMENT{
+      enum KIND{ kName, kAll, kSlice } Kind;
+
+      std::string Name;    // kName: decoded member name
+      uint32_t    Hash;    // kName: of "Name"
+      bool        IsIndex; // kName: "Name" is also a valid array index
+      size_t      Start;   // kName: the array index; kSlice: first item
+      size_t      End;     // kSlice: one past the last item
+    };
+    std::vector<SEGMENT> Segments;
+    bool                 Wildcard; // More than one value can match
+
+    bool  Matches(size_t Depth, const char* Name, size_t Length) const;
+    bool  Matches(size_t Depth, size_t Index) const;
+    JSON* Search (JSON* Node, size_t Depth, std::vector<JSON*>* Results) const;
+
+    // Passes the events of matching values on to the handler
+    class FILTER: public JSON_HANDLER{
+      private:
+        struct FRAME{
+          bool   Array;
+          bool   OnPath; // This container matches the pointer so far
+          bool   Member; // The current member is on the path
+          size_t Index;  // Of the next array item
+        };
+        const JSON_POINTER* Pointer;
+        JSON_HANDLER*       Handler;
+        std::vector<FRAME>  Stack;
+        size_t              Forward; // Nesting depth inside a matching value
+
+        bool Begin  (); // A value starts: true if it is on the path
+        bool Matched(); // A matching value is complete
+
+      public:
+        size_t Count; // Matches so far
+        bool   Done;  // Stopped, because nothing else can match
+
+        FILTER(const JSON_POINTER* Pointer, JSON_HANDLER* Handler);
+
+        bool Null  ();
+        bool Bool  (bool        Value);
+        bool Number(double      Value);
+        bool String(const char* Value, size_t Length);
+
+        bool Integer (int64_t  Value);
+        bool Unsigned(uint64_t Value);
+
+        bool StartObject();
+        bool Key        (const char* Name, size_t Length);
+        bool EndObject  ();
+
+        bool StartArray();
+        bool EndArray  ();
+    };
+
+  public:
+    JSON_POINTER();
+
+    // Returns false if "Pointer" is not valid.  "Extended" enables the
+    // wildcard and slice segments.
+    bool Compile(const char* Pointer, bool Extended = true);
+
+    // Returns the first match, or null
+    JSON* Find(JSON* Document) const;
+
+    // Appends all matches to "Results", in document order, and returns how
+    // many were found
+    size_t FindAll(JSON* Document, std::vector<JSON*>* Results) const;
+
+    // Parses "json" without building a document, and reports every matching
+    // value to "Handler" as a complete sequence of events.  Without wildcards
+    // the parse stops as soon as the match is found.  Returns false on a
+    // parse error, or if the handler stopped the parse.
+    bool Extract(JSON_HANDLER* Handler, const char* json, size_t Length = 0) const;
+
+    // As above, but "Result" is cleared and becomes an array of the matches
+    bool Extract(JSON* Result, const char* json, size_t Length = 0) const;
+};
+//------------------------------------------------------------------------------
+
+// Parses newline-delimited JSON ("JSON Lines": one value per line) on a pool
+// of threads.  The input is split into batches of whole lines, and every
+// thread parses its batches into its own arena, which is reused from one
+// batch to the next.
+class JSON_LINES{
+  public:
+    class HANDLER{
+      public:
+        virtual ~HANDLER(){}
+
+        // Receives every record.  "Offset" is the position of its line in
+        // the input, and "Record" is only valid for the duration of the
+        // call.  Returning false stops the parse.
+        virtual bool Record(uint64_t Offset, JSON* Record) = 0;
+
+        // Called instead of Record() for lines that cannot be parsed
+        virtual bool Error(uint64_t Offset){ return false; }
+    };
+
+  private:
+    struct JOB; // State shared by the threads of one parse
+
+    unsigned Threads;
+    size_t   BatchSize;
+    unsigned Features;
+
+    void Work(JOB* Job);
+
+  public:
+    // "Threads" is 0 for one per processor core.  Batches are at least
+    // "BatchSize" bytes, except for the last.
+    JSON_LINES(unsigned Threads = 0, size_t BatchSize = MiB);
+
+    // The dialect of the records, as for JSON_READER; the default is JSON5
+    void SetFeatures(unsigned Features);
+
+    // When "Ordered", the records are passed to the handler one at a time,
+    // in input order.  Otherwise they are passed as soon as they are
+    // parsed, concurrently from all the threads.
+    // Returns false if any line could not be parsed, or if the handler
+    // stopped the parse.
+    bool Parse    (HANDLER* Handler, const char* Data, size_t Length, bool Ordered = true);
+    bool ParseFile(HANDLER* Handler, const char* Filename, bool Ordered = true);
+};
+//------------------------------------------------------------------------------
+
+// Thread-safe table of object keys, so that documents with the same keys
+// share a single copy of each.  Interned keys that are equal have the same
+// address, which object look-ups compare before the contents.
+class JSON_KEYS{
+  private:
+    struct SHARD; // Locked independently, to reduce contention
+
+    SHARD* Shards;
+    size_t Limit;
+
+  public:
+    // Stops interning once "Limit" keys are stored, so that keys made from
+    // data (rather than from a schema) cannot grow it without bound
+    JSON_KEYS(size_t Limit = 0x10000);
+   ~JSON_KEYS();
+    JSON_KEYS(const JSON_KEYS&) = delete;
+    JSON_KEYS& operator= (const JSON_KEYS&) = delete;
+
+    // Returns the stored, null-terminated copy of the key, which is valid
+    // for the lifetime of the table, or null if the table is full
+    const char* Intern(const char* Name, size_t Length);
+
+    size_t Count();
+};
+//------------------------------------------------------------------------------
+
+// Random access to the values of a large top-level array (or object) in a
+// file.  The file is scanned once, matching the brackets of nested values,
+// to find where every value starts and ends.  The index can be saved next to
+// the file, so that later opens only map the file and load the index, after
+// which any one value is parsed without reading the rest.
+class JSON_INDEX{
+  public:
+    static const size_t NotFound = (size_t)-1;
+
+  private:
+    struct ENTRY{
+      uint64_t Offset; // Of the value's text in the file
+      uint64_t Length;
+    };
+    class OUTLINE; // Collects the entries during the scan
+
+    FILE_WRAPPER*            File;     // Mapped while open
+    const char*              Data;
+    uint64_t                 Size;
+    uint64_t                 Modified; // Time stamp of the file when mapped
+    std::vector<ENTRY>       Entries;
+    std::vector<std::string> Keys;  // Member names, when indexed
+    std::vector<size_t>      Slots; // Hash table of "Keys"
+
+    void MakeSlots();
+    bool Map(const char* Filename);
+
+  public:
+    JSON_INDEX();
+   ~JSON_INDEX();
+    JSON_INDEX(const JSON_INDEX&) = delete;
+    JSON_INDEX& operator= (const JSON_INDEX&) = delete;
+
+    // Maps the file and scans it.  "Keys" also indexes the member names of a
+    // top-level object, so that Find() can look them up.
+    bool Build(const char* Filename, bool Keys = true);
+
+    // The index file is in the byte order of the machine that wrote it, and
+    // is only loaded for a JSON file of the same size, modification time
+    // and first and last 4 kiB as when it was built
+    bool Save(const char* IndexName) const;
+    bool Load(const char* Filename, const char* IndexName);
+
+    // Loads the index, or builds and saves it if it does not exist or is
+    // out of date.  The default "IndexName" is "Filename" with ".idx" added.
+    bool Open(const char* Filename, const char* IndexName = 0);
+    void Close();
+
+    // The number of items (or members) of the top-level value
+    size_t GetCount() const;
+
+    // The source text of the value, which remains valid until Close()
+    const char* GetText(size_t Index, size_t* Length) const;
+
+    // Parses a single value; "Flags" is a combination of JSON::PARSE_FLAGS,
+    // and "Features" of JSON_READER::FEATURES
+    bool Get(size_t Index, JSON*         Value, unsigned Flags = 0) const;
+    bool Get(size_t Index, JSON_HANDLER* Handler, unsigned Features = JSON_READER::JSON5) const;
+
+    // Member names are only available when they were indexed: GetKey()
+    // returns null, and Find() returns "NotFound", otherwise
+    const char* GetKey(size_t Index) const;
+    size_t      Find  (const char* Name, size_t Length = 0) const;
 };
 //------------------------------------------------------------------------------
 
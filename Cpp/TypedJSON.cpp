@@ -0,0 +1,207 @@
+/*==============================================================================
+
+Copyright (C) John-Philip Taylor
+jpt13653903@gmail.com
+
+This file is part of a library
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+==============================================================================*/
+
+#include "TypedJSON.h"
+//------------------------------------------------------------------------------
+
+#include <atomic>
+//------------------------------------------------------------------------------
+
+using namespace std;
+//------------------------------------------------------------------------------
+
+JSON_FIELD_TABLE::JSON_FIELD_TABLE(vector<FIELD>&& Fields):
+  Fields(std::move(Fields))
+{
+  size_t Size = 1;
+  while(Size < 2*this->Fields.size()) Size *= 2;
+
+  // Search for a table size and a hash window that gives every name a slot
+  // of its own, so that a look-up is a single compare
+  unsigned Bits = 0;
+  while(((size_t)1 << Bits) < Size) Bits++;
+  for(unsigned Grow = 0; Grow < 4 && Bits + Grow <= 16; Grow++){
+    for(unsigned Shift = 0; Shift + Bits + Grow <= 32; Shift++){
+      if(Place(Size << Grow, Shift)) return;
+    }
+  }
+  // Names with equal hashes: fall back to linear probing
+  Place(Size, 0);
+}
+//------------------------------------------------------------------------------
+
+bool JSON_FIELD_TABLE::Place(size_t Size, unsigned Shift){
+  this->Mask  = (uint32_t)(Size - 1);
+  this->Shift = Shift;
+  Slots.assign(Size, -1);
+
+  bool Perfect = true;
+  for(size_t n = 0; n < Fields.size(); n++){
+    uint32_t Slot = (Fields[n].Hash >> Shift) & Mask;
+    while(Slots[Slot] >= 0){
+      Perfect = false;
+      Slot    = (Slot + 1) & Mask;
+    }
+    Slots[Slot] = (int)n;
+  }
+  return Perfect;
+}
+//------------------------------------------------------------------------------
+
+const JSON_FIELD_TABLE::FIELD* JSON_FIELD_TABLE::Find(const char* Name, size_t Length) const{
+  uint32_t Hash = JSON::OBJECTS::Hash(Name, Length);
+
+  for(uint32_t Slot = (Hash >> Shift) & Mask;; Slot = (Slot + 1) & Mask){
+    int n = Slots[Slot];
+    if(n < 0) return 0;
+
+    const FIELD* Field = &Fields[n];
+    if(
+      Field->Hash == Hash && Field->Length == Length &&
+      !memcmp(Field->Name, Name, Length)
+    ) return Field;
+  }
+}
+//------------------------------------------------------------------------------
+
+void JSON_DECODER::Begin(){
+  Target      = 0;
+  TargetCodec = 0;
+  Skip        = 0;
+  Stack.clear();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Error(){
+  static std::atomic<bool> FirstError(true); // Decoders can run concurrently
+  if(FirstError.exchange(false)){
+    error("JSON value does not match the bound type");
+  }
+  return false;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Next(void** Object, const JSON_CODEC** Codec){
+  if(Skip) return false;
+
+  if(Stack.empty()){
+    *Object = Root;
+    *Codec  = RootCodec;
+    return true;
+  }
+  FRAME* Top = &Stack.back();
+  if(Top->Array){
+    *Object = Top->Codec->Item(Top->Object, Codec);
+    return true;
+  }
+  *Object = Target;
+  *Codec  = TargetCodec;
+  return Target != 0;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Null(){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  Next(&Object, &Codec); // Array items are still appended
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Bool(bool Value){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  if(!Next(&Object, &Codec)) return true;
+  return Codec->Bool(Object, Value) || Error();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Number(double Value){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  if(!Next(&Object, &Codec)) return true;
+  return Codec->Number(Object, Value) || Error();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::String(const char* Value, size_t Length){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  if(!Next(&Object, &Codec)) return true;
+  return Codec->String(Object, Value, Length) || Error();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Integer(int64_t Value){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  if(!Next(&Object, &Codec)) return true;
+  return Codec->Integer(Object, Value) || Error();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Unsigned(uint64_t Value){
+  void*             Object;
+  const JSON_CODEC* Codec;
+  if(!Next(&Object, &Codec)) return true;
+  return Codec->Unsigned(Object, Value) || Error();
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::StartObject(){
+  FRAME Frame;
+  if(!Next(&Frame.Object, &Frame.Codec)){
+    Skip++;
+    return true;
+  }
+  if(!Frame.Codec->StartObject(Frame.Object)) return Error();
+  Frame.Array = false;
+  Stack.push_back(Frame);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::Key(const char* Name, size_t Length){
+  if(Skip) return true;
+
+  FRAME* Top = &Stack.back();
+  Target = Top->Codec->Member(Top->Object, Name, Length, &TargetCodec);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::EndObject(){
+  if(Skip) Skip--;
+  else     Stack.pop_back();
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::StartArray(){
+  FRAME Frame;
+  if(!Next(&Frame.Object, &Frame.Codec)){
+    Skip++;
+    return true;
+  }
+  if(!Frame.Codec->StartArray(Frame.Object)) return Error();
+  Frame.Array = true;
+  Stack.push_back(Frame);
+  return true;
+}
+//------------------------------------------------------------------------------
+
+bool JSON_DECODER::EndArray(){
+  if(Skip) Skip--;
+  else     Stack.pop_back();
+  return true;
+}
+//------------------------------------------------------------------------------
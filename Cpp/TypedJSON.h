@@ -0,0 +1,441 @@
+//==============================================================================
+// Copyright (C) John-Philip Taylor
+// jpt13653903@gmail.com
+//
+// This file is part of a library
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//==============================================================================
+
+// Binds JSON directly to C++ types, without building a document.  The
+// members of structs and classes are declared once, at global scope:
+//
+//   struct POINT{ int X, Y; std::string Name; std::vector<double> Values; };
+//
+//   JSON_BIND_TYPE(POINT){
+//     JSON_BIND(X);
+//     JSON_BIND(Y);
+//     JSON_BIND_AS(Name, "name");
+//     JSON_BIND(Values);
+//   }
+//
+// after which JSON_BINDING::Parse(&Point, json) decodes straight into the
+// members, and JSON_BINDING::Stringify(Point) encodes them again.  Members
+// can be bool, any arithmetic type, std::string, std::vector<T>,
+// std::map<std::string, T> or another bound type.
+//
+// Keys are found through a perfect hash: the hash of every member name is
+// computed by the compiler, and the table is laid out once per type so that
+// every name has a slot of its own.  Unknown keys are skipped, null leaves
+// the member unchanged, and integers must fit the member type.
+//------------------------------------------------------------------------------
+
+#ifndef TypedJSON_h
+#define TypedJSON_h
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <type_traits>
+//------------------------------------------------------------------------------
+
+#include "JSON.h"
+//------------------------------------------------------------------------------
+
+// FNV-1a, the same as JSON::OBJECTS::Hash, so that it can be evaluated by the
+// compiler
+constexpr uint32_t JSON_NameHash(const char* Name, uint32_t Hash = 0x811C9DC5){
+  return *Name ? JSON_NameHash(Name+1, (Hash ^ (uint8_t)*Name) * 0x01000193u) : Hash;
+}
+//------------------------------------------------------------------------------
+
+// Specialised by JSON_BIND_TYPE
+template<class T> struct JSON_FIELDS{ enum{ Bound = 0 }; };
+
+#define JSON_BIND_TYPE(Type)                                                  \
+  template<> struct JSON_FIELDS<Type>{                                        \
+    enum{ Bound = 1 };                                                        \
+    template<class VISITOR> static void Visit(VISITOR& Visitor, Type& Object);\
+  };                                                                          \
+  template<class VISITOR> void JSON_FIELDS<Type>::Visit(VISITOR& Visitor, Type& Object)
+
+#define JSON_BIND_AS(Member, Name)                                            \
+  Visitor(Name, sizeof(Name)-1,                                               \
+          std::integral_constant<uint32_t, JSON_NameHash(Name)>::value,       \
+          Object.Member)
+
+#define JSON_BIND(Member) JSON_BIND_AS(Member, #Member)
+//------------------------------------------------------------------------------
+
+// What a decoder can do with a value of a given type, so that the decoder
+// itself need not be a template.  "Object" points to the value.  The
+// functions return false when the JSON does not match the type.
+struct JSON_CODEC{
+  bool (*Bool    )(void* Object, bool        Value);
+  bool (*Number  )(void* Object, double      Value);
+  bool (*Integer )(void* Object, int64_t     Value);
+  bool (*Unsigned)(void* Object, uint64_t    Value);
+  bool (*String  )(void* Object, const char* Value, size_t Length);
+
+  // Objects: Member returns the value for a key, or null to skip it
+  bool  (*StartObject)(void* Object);
+  void* (*Member     )(void* Object, const char* Name, size_t Length, const JSON_CODEC** Codec);
+
+  // Arrays: Item appends a value and returns it
+  bool  (*StartArray)(void* Object);
+  void* (*Item      )(void* Object, const JSON_CODEC** Codec);
+
+  // One constant table per JSON_TYPE, so that it needs no initialisation
+  template<class TYPE> static const JSON_CODEC* Get(){
+    static const JSON_CODEC Codec = {
+      &TYPE::Bool  , &TYPE::Number     , &TYPE::Integer, &TYPE::Unsigned,
+      &TYPE::String, &TYPE::StartObject, &TYPE::Member ,
+      &TYPE::StartArray, &TYPE::Item
+    };
+    return &Codec;
+  }
+};
+//------------------------------------------------------------------------------
+
+// The members of a bound type, indexed by a perfect hash
+class JSON_FIELD_TABLE{
+  public:
+    struct FIELD{
+      const char*       Name;
+      size_t            Length;
+      uint32_t          Hash;   // Of the name, from the compiler
+      size_t            Offset; // Of the member in the object
+      const JSON_CODEC* Codec;
+    };
+    std::vector<FIELD> Fields;
+
+  private:
+    std::vector<int> Slots; // Index into "Fields", or -1 for empty
+    uint32_t         Mask;
+    unsigned         Shift; // The slot is (Hash >> Shift) & Mask
+
+    bool Place(size_t Size, unsigned Shift); // False on a collision
+
+  public:
+    JSON_FIELD_TABLE(std::vector<FIELD>&& Fields);
+
+    const FIELD* Find(const char* Name, size_t Length) const;
+};
+//------------------------------------------------------------------------------
+
+// Type mismatches, for the functions that a type does not override
+struct JSON_TYPE_BASE{
+  static bool Bool    (void* Object, bool        Value){ return false; }
+  static bool Number  (void* Object, double      Value){ return false; }
+  static bool Integer (void* Object, int64_t     Value){ return false; }
+  static bool Unsigned(void* Object, uint64_t    Value){ return false; }
+  static bool String  (void* Object, const char* Value, size_t Length){ return false; }
+
+  static bool  StartObject(void* Object){ return false; }
+  static void* Member     (void* Object, const char* Name, size_t Length, const JSON_CODEC** Codec){ return 0; }
+
+  static bool  StartArray(void* Object){ return false; }
+  static void* Item      (void* Object, const JSON_CODEC** Codec){ return 0; }
+};
+//------------------------------------------------------------------------------
+
+// Bound structs and classes; the specialisations below handle the rest
+template<class T, class ENABLE = void> struct JSON_TYPE: JSON_TYPE_BASE{
+  static_assert(JSON_FIELDS<T>::Bound, "The type is not bound: use JSON_BIND_TYPE");
+
+  struct COLLECT{
+    T*                                     Object;
+    std::vector<JSON_FIELD_TABLE::FIELD>*  Fields;
+
+    template<class F> void operator()(const char* Name, size_t Length, uint32_t Hash, F& Field){
+      JSON_FIELD_TABLE::FIELD Entry;
+      Entry.Name   = Name;
+      Entry.Length = Length;
+      Entry.Hash   = Hash;
+      Entry.Offset = (size_t)((char*)&Field - (char*)Object);
+      Entry.Codec  = JSON_CODEC::Get<JSON_TYPE<F>>();
+      Fields->push_back(Entry);
+    }
+  };
+
+  struct EMIT{
+    JSON_HANDLER* Handler;
+    bool          Result;
+
+    template<class F> void operator()(const char* Name, size_t Length, uint32_t Hash, F& Field){
+      Result = Result && Handler->Key(Name, Length) && JSON_TYPE<F>::Emit(Handler, Field);
+    }
+  };
+
+  // Built from the first object seen: member offsets are the same in all
+  static const JSON_FIELD_TABLE& Table(T* Object){
+    static const JSON_FIELD_TABLE Table(Collect(Object));
+    return Table;
+  }
+
+  static std::vector<JSON_FIELD_TABLE::FIELD> Collect(T* Object){
+    std::vector<JSON_FIELD_TABLE::FIELD> Fields;
+    COLLECT Visitor = {Object, &Fields};
+    JSON_FIELDS<T>::Visit(Visitor, *Object);
+    return Fields;
+  }
+
+  static bool StartObject(void* Object){ return true; }
+
+  static void* Member(void* Object, const char* Name, size_t Length, const JSON_CODEC** Codec){
+    const JSON_FIELD_TABLE::FIELD* Field = Table((T*)Object).Find(Name, Length);
+    if(!Field) return 0;
+    *Codec = Field->Codec;
+    return (char*)Object + Field->Offset;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const T& Value){
+    T& Object = const_cast<T&>(Value); // Only read
+
+    EMIT Visitor = {Handler, true};
+    if(!Handler->Size(Table(&Object).Fields.size()) || !Handler->StartObject()) return false;
+    JSON_FIELDS<T>::Visit(Visitor, Object);
+    return Visitor.Result && Handler->EndObject();
+  }
+};
+//------------------------------------------------------------------------------
+
+template<> struct JSON_TYPE<bool>: JSON_TYPE_BASE{
+  static bool Bool(void* Object, bool Value){
+    *(bool*)Object = Value;
+    return true;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const bool& Value){
+    return Handler->Bool(Value);
+  }
+};
+//------------------------------------------------------------------------------
+
+template<class T> struct JSON_TYPE<T, typename std::enable_if<
+  std::is_integral<T>::value && !std::is_same<T, bool>::value
+>::type>: JSON_TYPE_BASE{
+  typedef std::numeric_limits<T> LIMITS;
+
+  static bool Integer(void* Object, int64_t Value){
+    if(LIMITS::is_signed){
+      if(Value < (int64_t)LIMITS::min() || Value > (int64_t)LIMITS::max()) return false;
+    }else{
+      if(Value < 0 || (uint64_t)Value > (uint64_t)LIMITS::max()) return false;
+    }
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  static bool Unsigned(void* Object, uint64_t Value){
+    if(Value > (uint64_t)LIMITS::max()) return false;
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  // Integral values written with a fraction or exponent, such as 1e3
+  static bool Number(void* Object, double Value){
+    if(Value != floor(Value)) return false;
+    if(Value < (double)LIMITS::min() || Value >= ldexp(1.0, LIMITS::digits)) return false;
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const T& Value){
+    if(LIMITS::is_signed) return Handler->Integer ((int64_t )Value);
+    else                  return Handler->Unsigned((uint64_t)Value);
+  }
+};
+//------------------------------------------------------------------------------
+
+template<class T> struct JSON_TYPE<T, typename std::enable_if<
+  std::is_floating_point<T>::value
+>::type>: JSON_TYPE_BASE{
+  static bool Number(void* Object, double Value){
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  static bool Integer(void* Object, int64_t Value){
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  static bool Unsigned(void* Object, uint64_t Value){
+    *(T*)Object = (T)Value;
+    return true;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const T& Value){
+    return Handler->Number((double)Value);
+  }
+};
+//------------------------------------------------------------------------------
+
+template<> struct JSON_TYPE<std::string>: JSON_TYPE_BASE{
+  static bool String(void* Object, const char* Value, size_t Length){
+    ((std::string*)Object)->assign(Value, Length);
+    return true;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const std::string& Value){
+    return Handler->String(Value.data(), Value.length());
+  }
+};
+//------------------------------------------------------------------------------
+
+template<class T> struct JSON_TYPE<std::vector<T>>: JSON_TYPE_BASE{
+  static bool StartArray(void* Object){
+    ((std::vector<T>*)Object)->clear();
+    return true;
+  }
+
+  static void* Item(void* Object, const JSON_CODEC** Codec){
+    std::vector<T>* Vector = (std::vector<T>*)Object;
+    Vector->emplace_back();
+    *Codec = JSON_CODEC::Get<JSON_TYPE<T>>();
+    return &Vector->back();
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const std::vector<T>& Value){
+    if(!Handler->Size(Value.size()) || !Handler->StartArray()) return false;
+    for(size_t n = 0; n < Value.size(); n++){
+      if(!JSON_TYPE<T>::Emit(Handler, Value[n])) return false;
+    }
+    return Handler->EndArray();
+  }
+};
+//------------------------------------------------------------------------------
+
+// The items of a vector<bool> are not addressable, so that each is appended
+// as "false" and then set through the vector itself
+template<> struct JSON_TYPE<std::vector<bool>>: JSON_TYPE_BASE{
+  struct ITEM: JSON_TYPE_BASE{
+    static bool Bool(void* Object, bool Value){
+      ((std::vector<bool>*)Object)->back() = Value;
+      return true;
+    }
+  };
+
+  static bool StartArray(void* Object){
+    ((std::vector<bool>*)Object)->clear();
+    return true;
+  }
+
+  static void* Item(void* Object, const JSON_CODEC** Codec){
+    ((std::vector<bool>*)Object)->push_back(false);
+    *Codec = JSON_CODEC::Get<ITEM>();
+    return Object;
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const std::vector<bool>& Value){
+    if(!Handler->Size(Value.size()) || !Handler->StartArray()) return false;
+    for(size_t n = 0; n < Value.size(); n++){
+      if(!Handler->Bool(Value[n])) return false;
+    }
+    return Handler->EndArray();
+  }
+};
+//------------------------------------------------------------------------------
+
+template<class T> struct JSON_TYPE<std::map<std::string, T>>: JSON_TYPE_BASE{
+  typedef std::map<std::string, T> MAP;
+
+  static bool StartObject(void* Object){
+    ((MAP*)Object)->clear();
+    return true;
+  }
+
+  static void* Member(void* Object, const char* Name, size_t Length, const JSON_CODEC** Codec){
+    *Codec = JSON_CODEC::Get<JSON_TYPE<T>>();
+    return &(*(MAP*)Object)[std::string(Name, Length)];
+  }
+
+  static bool Emit(JSON_HANDLER* Handler, const MAP& Value){
+    if(!Handler->Size(Value.size()) || !Handler->StartObject()) return false;
+    for(auto Member = Value.begin(); Member != Value.end(); Member++){
+      if(!Handler->Key(Member->first.data(), Member->first.length())) return false;
+      if(!JSON_TYPE<T>::Emit(Handler, Member->second)) return false;
+    }
+    return Handler->EndObject();
+  }
+};
+//------------------------------------------------------------------------------
+
+// Receives the events of a JSON_READER (or JSON_STREAM, or one of the binary
+// readers) and stores them in a bound value
+class JSON_DECODER: public JSON_HANDLER{
+  private:
+    struct FRAME{
+      void*             Object;
+      const JSON_CODEC* Codec;
+      bool              Array;
+    };
+    void*              Root;
+    const JSON_CODEC*  RootCodec;
+    void*              Target;      // Value of the most recent key
+    const JSON_CODEC*  TargetCodec;
+    std::vector<FRAME> Stack;       // Open objects and arrays
+    size_t             Skip;        // Depth inside the value of an unknown key
+
+    // Finds the value for the next event: false if it is to be skipped
+    bool Next(void** Object, const JSON_CODEC** Codec);
+
+    bool Error();
+
+  public:
+    template<class T> JSON_DECODER(T* Value){
+      Root      = Value;
+      RootCodec = JSON_CODEC::Get<JSON_TYPE<T>>();
+      Begin();
+    }
+
+    // Prepares for a new parse into the same value
+    void Begin();
+
+    bool Null  ();
+    bool Bool  (bool        Value);
+    bool Number(double      Value);
+    bool String(const char* Value, size_t Length);
+
+    bool Integer (int64_t  Value);
+    bool Unsigned(uint64_t Value);
+
+    bool StartObject();
+    bool Key        (const char* Name, size_t Length);
+    bool EndObject  ();
+
+    bool StartArray();
+    bool EndArray  ();
+};
+//------------------------------------------------------------------------------
+
+class JSON_BINDING{
+  public:
+    // Decodes the JSON (or JSON-5) straight into "Value".  If "Length" is 0,
+    // "strlen" is used to determine the length.  Returns false on a syntax
+    // error, or if the JSON does not match the type.
+    template<class T> static bool Parse(T* Value, const char* json, size_t Length = 0){
+      JSON_DECODER Decoder(Value);
+      JSON_READER  Reader;
+      return Reader.Parse(&Decoder, json, Length);
+    }
+
+    // Reports the value to a handler (e.g. a JSON_WRITER) as events
+    template<class T> static bool Emit(JSON_HANDLER* Handler, const T& Value){
+      return JSON_TYPE<T>::Emit(Handler, Value);
+    }
+
+    template<class T> static std::string Stringify(const T& Value, int Indent = 0){
+      JSON_WRITER Writer(Indent);
+      Emit(&Writer, Value);
+      return std::string(Writer.GetBuffer(), Writer.GetLength());
+    }
+};
+//------------------------------------------------------------------------------
+
+#endif
+//------------------------------------------------------------------------------
@@ -9,11 +9,20 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 //==============================================================================
 
+#include <atomic>
+#include <thread>
+//------------------------------------------------------------------------------
+
 #include "test.h"
 #include "JSON.h"
+#include "BinaryJSON.h"
+#include "TypedJSON.h"
 #include "FileWrapper.h"
 //------------------------------------------------------------------------------
 
+using namespace std;
+//------------------------------------------------------------------------------
+
 bool TestBuild(){
   Start("Testing json building and access functions");
 
@@ -38,10 +47,10 @@ bool TestBuild(){
   info("json = %s", json.Stringify());
   assert(!strcmp(json.Stringify(),
     "{"
-      "\"MyArray\":[0,1,2,3,4,5,6,7,8,9],"
-      "\"Number\":789.456,"
       "\"String\":\"MyString\","
-      "\"Wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\""
+      "\"Number\":789.456,"
+      "\"Wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\","
+      "\"MyArray\":[0,1,2,3,4,5,6,7,8,9]"
     "}"), return false);
 
   Done(); return true;
@@ -74,24 +83,24 @@ bool TestLoad(){
   info("json = %s", json.Stringify());
   assert(!strcmp(json.Stringify(),
     "{"
-      "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
+      "\"string\":\"String with unicode...Ω...\","
+      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\","
       "\"number\":123.456,"
+      "\"state1\":true,"
+      "\"state2\":false,"
+      "\"state3\":null,"
+      "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
       "\"object\":{"
-        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
-        "\"array2\":[],"
-        "\"integer\":123,"
+        "\"string\":\"String\","
         "\"number\":123.456,"
-        "\"object\":{},"
+        "\"integer\":123,"
         "\"state1\":true,"
         "\"state2\":false,"
         "\"state3\":null,"
-        "\"string\":\"String\""
-      "},"
-      "\"state1\":true,"
-      "\"state2\":false,"
-      "\"state3\":null,"
-      "\"string\":\"String with unicode...Ω...\","
-      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\""
+        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
+        "\"object\":{},"
+        "\"array2\":[]"
+      "}"
     "}"), return false);
 
   Done();
@@ -114,25 +123,25 @@ bool TestLoad(){
   info("After update: %s", json.Stringify());
   assert(!strcmp(json.Stringify(),
     "{"
-      "\"array\":[1,2,3,4],"
+      "\"string\":\"New String\","
+      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\","
       "\"number\":123.456,"
+      "\"state1\":true,"
+      "\"state2\":false,"
+      "\"state3\":null,"
+      "\"array\":[1,2,3,4],"
       "\"object\":{"
-        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
-        "\"array2\":[8,7,6,5,4,3,2,1],"
-        "\"integer\":123,"
+        "\"string\":\"String\","
         "\"number\":987.654,"
-        "\"object\":\"Changed the type to a string\","
+        "\"integer\":123,"
         "\"state1\":true,"
         "\"state2\":false,"
         "\"state3\":null,"
-        "\"string\":\"String\""
+        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
+        "\"object\":\"Changed the type to a string\","
+        "\"array2\":[8,7,6,5,4,3,2,1]"
       "},"
-      "\"state1\":true,"
-      "\"state2\":false,"
-      "\"state3\":null,"
-      "\"state4\":true,"
-      "\"string\":\"New String\","
-      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\""
+      "\"state4\":true"
     "}"), return false);
 
   Done(); return true;
@@ -165,41 +174,1597 @@ bool TestJSON5(){
   info("json = %s", json.Stringify());
   assert(!strcmp(json.Stringify(),
     "{"
-      "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
+      "\"string\":\"String with unicode...Ω...\","
+      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\","
       "\"number\":123.456,"
+      "\"state1\":true,"
+      "\"state2\":false,"
+      "\"state3\":null,"
+      "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
       "\"object\":{"
-        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
-        "\"array2\":[],"
-        "\"integer\":123,"
+        "\"string\":\"String\","
         "\"number2\":912559,"
         "\"number3\":-12648430,"
-        "\"object\":{},"
+        "\"integer\":123,"
+        "\"withFractionPart\":-123.456,"
         "\"onlyFractionPart\":0.456,"
+        "\"withExponent\":0.0123,"
         "\"state1\":true,"
         "\"state2\":false,"
         "\"state3\":null,"
-        "\"string\":\"String\","
-        "\"withExponent\":0.0123,"
-        "\"withFractionPart\":-123.456"
-      "},"
-      "\"state1\":true,"
-      "\"state2\":false,"
-      "\"state3\":null,"
-      "\"string\":\"String with unicode...Ω...\","
-      "\"wierd\":\"\\\\\\\"\\/\\b\\f\\n\\r\\t and some more...\""
+        "\"array\":[\"one\",\"two\",\"three\",\"four\"],"
+        "\"object\":{},"
+        "\"array2\":[]"
+      "}"
     "}"), return false);
 
   Done(); return true;
 }
 //------------------------------------------------------------------------------
 
+bool TestArena(){
+  Start("Testing arena allocation");
+
+  string Source = "[";
+  for(int n = 0; n < 10000; n++){
+    char s[0x100];
+    sprintf(s,
+      "%s{\"id\": %d, \"name\": \"Item number %d with a long name\", "
+      "\"tags\": [\"a\", \"b\"], \"active\": %s}",
+      n ? ", " : "", n, n, (n & 1) ? "true" : "false"
+    );
+    Source += s;
+  }
+  Source += "]";
+
+  JSON Heap;
+  if(!Heap.Parse(Source.c_str())){
+    error("Parse error");
+    return false;
+  }
+  string Expected = Heap.Stringify();
+
+  JSON json;
+  for(int n = 0; n < 3; n++){ // Repeated to exercise arena reuse
+    if(!json.Parse(Source.c_str(), 0, JSON::pfArena)){
+      error("Parse error");
+      return false;
+    }
+    assert(Expected == json.Stringify(), return false);
+  }
+
+  // Values added to an arena document end up in the same arena
+  json[3]->AddOrUpdate("extra", "Added after parsing, to the arena document");
+  json.Append(Heap);
+  info("json[3] = %s", json[3]->Stringify());
+  assert(!strcmp((*json[3])["extra"]->String.c_str(),
+                 "Added after parsing, to the arena document"), return false);
+  assert(json[10000]->Items.size() == 10000, return false);
+
+  // After clearing, the object is a normal heap object again
+  json.Clear();
+  json.AddOrUpdate("String", "MyString");
+  assert(!strcmp(json.Stringify(), "{\"String\":\"MyString\"}"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestInSitu(){
+  Start("Testing in-situ parsing");
+
+  FILE_WRAPPER File;
+  uint64_t     Size;
+  char*        Buffer = (char*)File.ReadAll("Resources/JSON5.json", &Size);
+  if(!Buffer){
+    error("Cannot read \"Resources/JSON5.json\"");
+    return false;
+  }
+
+  JSON Copied;
+  if(!Copied.Parse(Buffer)){
+    error("Parse error");
+    return false;
+  }
+  string Expected = Copied.Stringify();
+
+  JSON Owned;
+  if(!Owned.Parse(Buffer, 0, JSON::pfInSitu | JSON::pfArena)){
+    error("Parse error");
+    return false;
+  }
+  assert(Expected == Owned.Stringify(), return false);
+
+  JSON json;
+  if(!json.ParseInSitu(Buffer, Size)){
+    error("Parse error");
+    return false;
+  }
+  info("json = %s", json.Stringify());
+  assert(Expected == json.Stringify(), return false);
+
+  // Values without escapes refer directly to the caller's buffer,
+  // while those with escape sequences are decoded in place
+  const char* String = json["string"]->String.c_str();
+  const char* Wierd  = json["wierd" ]->String.c_str();
+  assert(String >= Buffer && String < Buffer + Size, return false);
+  assert(Wierd  >= Buffer && Wierd  < Buffer + Size, return false);
+  assert(!strcmp(Wierd, "\\\"/\b\f\n\r\t and some more..."), return false);
+
+  // Copies do not depend on the buffer
+  JSON Copy(json);
+  json.Clear();
+  delete[] Buffer;
+  assert(Expected == Copy.Stringify(), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+class EVENT_LOGGER: public JSON_HANDLER{
+  public:
+    string Log;
+    int    Limit = -1; // Stop after this many events
+
+    bool Event(const char* Name, const char* Value = 0, size_t Length = 0){
+      Log += Name;
+      if(Value){
+        Log += '(';
+        Log.append(Value, Length);
+        Log += ')';
+      }
+      Log += ' ';
+      return --Limit;
+    }
+
+    bool Null  ()                                   { return Event("Null"); }
+    bool Bool  (bool        Value)                  { return Event(Value ? "True" : "False"); }
+    bool Number(double      Value)                  {
+      char s[0x100];
+      sprintf(s, "%g", Value);
+      return Event("Number", s, strlen(s));
+    }
+    bool String(const char* Value, size_t Length)   { return Event("String", Value, Length); }
+    bool StartObject()                              { return Event("StartObject"); }
+    bool Key        (const char* Name, size_t Length){ return Event("Key", Name, Length); }
+    bool EndObject  ()                              { return Event("EndObject"); }
+    bool StartArray ()                              { return Event("StartArray"); }
+    bool EndArray   ()                              { return Event("EndArray"); }
+};
+//------------------------------------------------------------------------------
+
+bool TestEvents(){
+  Start("Testing the event-driven reader");
+
+  JSON_READER  Reader;
+  EVENT_LOGGER Logger;
+
+  const char* Source =
+    "// JSON-5 features are reported like any other\n"
+    "{ name: 'Reader', list: [1, 0x10, -.5e1, true, false, null, {}, []], "
+    "  \"nested\": {\"a\": \"b\\n\"}, }";
+
+  if(!Reader.Parse(&Logger, Source)){
+    error("Parse error");
+    return false;
+  }
+  info("Events: %s", Logger.Log.c_str());
+  assert(Logger.Log ==
+    "StartObject "
+      "Key(name) String(Reader) "
+      "Key(list) StartArray "
+        "Number(1) Number(16) Number(-5) True False Null "
+        "StartObject EndObject StartArray EndArray "
+      "EndArray "
+      "Key(nested) StartObject Key(a) String(b\n) EndObject "
+    "EndObject ", return false);
+
+  // A handler can stop the parse at any point
+  Logger.Log   = "";
+  Logger.Limit = 4;
+  assert(!Reader.Parse(&Logger, Source), return false);
+  assert(Logger.Log == "StartObject Key(name) String(Reader) Key(list) ", return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestStream(){
+  Start("Testing the chunked push parser");
+
+  const char* Files[] = {"Resources/JSON.json", "Resources/JSON5.json"};
+
+  for(int f = 0; f < 2; f++){
+    FILE_WRAPPER File;
+    uint64_t     Size;
+    char*        Buffer = (char*)File.ReadAll(Files[f], &Size);
+    if(!Buffer){
+      error("Cannot read \"%s\"", Files[f]);
+      return false;
+    }
+    JSON Expected;
+    if(!Expected.Parse(Buffer)){
+      error("Parse error");
+      return false;
+    }
+
+    // Every chunk size splits tokens, escapes and comments differently
+    for(size_t ChunkSize = 1; ChunkSize <= Size; ChunkSize++){
+      JSON        json;
+      JSON_STREAM Stream;
+      Stream.Begin(&json, ChunkSize & 1 ? JSON::pfArena : 0);
+
+      for(size_t n = 0; n < Size; n += ChunkSize){
+        size_t Length = Size - n < ChunkSize ? Size - n : ChunkSize;
+        assert(Stream.Parse(Buffer + n, Length), return false);
+      }
+      assert(Stream.End(), return false);
+      assert(!strcmp(json.Stringify(), Expected.Stringify()),
+             info("Chunk size = %u", (unsigned)ChunkSize); return false);
+    }
+    info("%s: all chunk sizes from 1 to %u OK", Files[f], (unsigned)Size);
+    delete[] Buffer;
+  }
+
+  // Events are the same as those of the single-buffer reader
+  const char* Source =
+    "/* Numbers */ [12345, -Infinity, 0x1F, 'single \\u0041', {key: \"value\"}] ";
+
+  JSON_READER  Reader;
+  EVENT_LOGGER Expected;
+  EVENT_LOGGER Logger;
+  assert(Reader.Parse(&Expected, Source), return false);
+
+  JSON_STREAM Stream;
+  Stream.Begin(&Logger);
+  for(int n = 0; Source[n]; n++) assert(Stream.Parse(Source + n, 1), return false);
+  assert(Stream.End(), return false);
+  info("Events: %s", Logger.Log.c_str());
+  assert(Logger.Log == Expected.Log, return false);
+
+  // Incomplete input is only an error once the end is reached
+  info("Expect an error message:");
+  Stream.Begin(&Logger);
+  assert( Stream.Parse("[1, 2", 5), return false);
+  assert(!Stream.End(), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestFile(){
+  Start("Testing memory-mapped file parsing");
+
+  JSON         json, Expected;
+  FILE_WRAPPER File;
+  char*        Buffer = (char*)File.ReadAll("Resources/JSON5.json");
+  assert(Buffer, return false);
+  assert(Expected.Parse(Buffer), return false);
+  delete[] Buffer;
+
+  assert(json.ParseFile("Resources/JSON5.json"), return false);
+  assert(!strcmp(json.Stringify(), Expected.Stringify()), return false);
+
+  assert(json.ParseFile("Resources/JSON5.json", JSON::pfArena | JSON::pfInSitu), return false);
+  assert(!strcmp(json.Stringify(), Expected.Stringify()), return false);
+
+  // A file that fills whole pages exactly, so that nothing of the file
+  // itself can serve as the terminator
+  string Source = "[\"";
+  Source.append(8192 - Source.length() - 2, 'x');
+  Source += "\"]";
+  assert(File.WriteAll("testOutput/Pages.json", (const byte*)Source.c_str()), return false);
+  assert(json.ParseFile("testOutput/Pages.json"), return false);
+  assert(json.Items.size() == 1 && json.Items[0]->String.length() == 8188, return false);
+
+  info("Expect an error message:");
+  assert(!json.ParseFile("Resources/NonExistent.json"), return false);
+  assert(json.Type == JSON::typeNull, return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestScan(){
+  Start("Testing long strings and whitespace runs");
+
+  // Escapes and quotes at every offset within and across vector blocks
+  for(int Length = 0; Length < 100; Length++){
+    for(int Escape = 0; Escape <= Length; Escape++){
+      string Source   = "[\"";
+      string Expected;
+      for(int n = 0; n < Length; n++){
+        if(n == Escape){
+          Source   += "\\\"'";
+          Expected += "\"'";
+        }
+        char Char = 'a' + n % 26;
+        Source   += Char;
+        Expected += Char;
+      }
+      Source += "\"";
+      Source.append(Escape, Escape & 1 ? ' ' : '\n');
+      Source += "]";
+
+      JSON json;
+      assert(json.Parse(Source.c_str(), Source.length()), return false);
+      assert(json.Items.size() == 1, return false);
+      assert(json.Items[0]->String.length() == Expected.length(), return false);
+      assert(!strcmp(json.Items[0]->String.c_str(), Expected.c_str()), return false);
+    }
+  }
+
+  // Control characters are still rejected inside long strings
+  string Source = "\"";
+  Source.append(40, 'x');
+  Source += "\n\"";
+  JSON json;
+  assert(!json.Parse(Source.c_str()), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestNumber(){
+  Start("Testing number parsing");
+
+  JSON json;
+  assert(json.Parse(
+    "[12345678901234567890, -9223372036854775808, 9007199254740993, "
+    "1E+2, 0x7FFFFFFFFFFFFFFF, -0, 1.5]"
+  ), return false);
+  assert(json.Items.size() == 7, return false);
+
+  assert(!json.Items[0]->IsInt64 (), return false);
+  assert( json.Items[0]->IsUint64(), return false);
+  assert( json.Items[0]->GetUint64() == 12345678901234567890ull, return false);
+
+  assert( json.Items[1]->IsInt64 (), return false);
+  assert(!json.Items[1]->IsUint64(), return false);
+  assert( json.Items[1]->GetInt64() == INT64_MIN, return false);
+
+  assert(json.Items[2]->GetInt64() == 9007199254740993ll, return false);
+  assert(json.Items[2]->Number     == 9007199254740992.0, return false);
+
+  assert(!json.Items[3]->IsInt64(), return false);
+  assert( json.Items[3]->Number == 100, return false);
+
+  assert(json.Items[4]->GetInt64() == INT64_MAX, return false);
+
+  assert(!json.Items[5]->IsInt64() && signbit(json.Items[5]->Number), return false);
+  assert(!json.Items[6]->IsInt64() && json.Items[6]->Number == 1.5, return false);
+
+  const char* Expected = "[12345678901234567890,-9223372036854775808,"
+                         "9007199254740993,100,9223372036854775807,-0,1.5]";
+  info("%s", json.Stringify());
+  assert(!strcmp(json.Stringify(), Expected), return false);
+
+  // Every parsed double must be the correctly rounded one
+  const char* Hard[] = {
+    "0.1", "0.30000000000000004", "9007199254740993.0", "2.2250738585072014e-308",
+    "4.9406564584124654e-324", "1.7976931348623157e308", "1e23", "8.41e21",
+    "123456789012345678901234567890", ".5e-3", "7.", "1e-400", "1e400"
+  };
+  for(int n = 0; n < (int)(sizeof(Hard)/sizeof(*Hard)); n++){
+    assert(json.Parse(Hard[n]), return false);
+    assert(json.Number == strtod(Hard[n], 0), info("%s", Hard[n]); return false);
+  }
+  srand(1);
+  for(int n = 0; n < 100000; n++){
+    uint64_t Bits = 0;
+    for(int b = 0; b < 4; b++) Bits = (Bits << 16) ^ (rand() & 0xFFFF);
+    double Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    if(!isfinite(Value)) continue;
+
+    char s[64];
+    sprintf(s, n & 1 ? "%.17g" : "%.15g", Value);
+    assert(json.Parse(s), return false);
+    assert(json.Number == strtod(s, 0), info("%s", s); return false);
+  }
+
+  // Exponents and hexadecimal numbers need at least one digit
+  const char* Incomplete[] = {"[1e]", "[1e+]", "[2.5E-]", "1e", "[0x]", "[-0x,1]", "0x"};
+  info("Expect an error message:");
+  for(int n = 0; n < (int)(sizeof(Incomplete)/sizeof(*Incomplete)); n++){
+    assert(!json.Parse(Incomplete[n]), info("%s", Incomplete[n]); return false);
+  }
+  assert(json.Parse("[1e0,0x0]") && !strcmp(json.Stringify(), "[1,0]"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+// Number of digits from the first to the last non-zero one in the mantissa
+int SignificantDigits(const char* Number){
+  int First = -1, Last = -1, Count = 0;
+  for(int n = 0; Number[n] && Number[n] != 'e'; n++){
+    if(Number[n] < '0' || Number[n] > '9') continue;
+    if(Number[n] != '0'){
+      if(First < 0) First = Count;
+      Last = Count;
+    }
+    Count++;
+  }
+  return First < 0 ? 0 : Last - First + 1;
+}
+//------------------------------------------------------------------------------
+
+bool TestFormat(){
+  Start("Testing number formatting");
+
+  struct{ double Value; const char* Expected; } Cases[] = {
+    {0.1                    , "0.1"                    },
+    {-0.0                   , "-0"                     },
+    {123.0                  , "123"                    },
+    {1.5e-7                 , "1.5e-7"                 },
+    {0.000001               , "0.000001"               },
+    {1e21                   , "1e+21"                  },
+    {123456789012345680000.0, "123456789012345680000"  },
+    {5e-324                 , "5e-324"                 },
+    {1.7976931348623157e308 , "1.7976931348623157e+308"},
+    {0.30000000000000004    , "0.30000000000000004"    },
+    {1.0/0.0                , "null"                   }
+  };
+  JSON json;
+  for(int n = 0; n < (int)(sizeof(Cases)/sizeof(*Cases)); n++){
+    json = Cases[n].Value;
+    assert(!strcmp(json.Stringify(), Cases[n].Expected),
+           info("%s", json.Stringify()); return false);
+  }
+
+  // Random bit patterns must survive the round trip exactly
+  int Longer = 0;
+  srand(2);
+  for(int n = 0; n < 100000; n++){
+    uint64_t Bits = 0;
+    for(int b = 0; b < 4; b++) Bits = (Bits << 16) ^ (rand() & 0xFFFF);
+    double Value;
+    memcpy(&Value, &Bits, sizeof(Value));
+    if(!isfinite(Value)) continue;
+
+    json = Value;
+    const char* String = json.Stringify();
+    assert(strtod(String, 0) == Value, info("%s", String); return false);
+
+    char Shortest[32];
+    for(int Precision = 1; Precision <= 17; Precision++){
+      sprintf(Shortest, "%.*e", Precision - 1, Value);
+      if(strtod(Shortest, 0) == Value) break;
+    }
+    int Digits   = SignificantDigits(String);
+    int Expected = SignificantDigits(Shortest);
+    if(Digits > Expected) Longer++;
+  }
+  info("%d of 100000 not the shortest", Longer);
+  assert(Longer < 500, return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestWriter(){
+  Start("Testing the writer");
+
+  JSON json;
+  assert(json.Parse(
+    "{\"a\": [1, 2.5, {}], \"b\\\"c\": \"x\\u0001/\", \"d\": []}"
+  ), return false);
+
+  const char* Expected = "{\"a\":[1,2.5,{}],\"b\\\"c\":\"x\\u0001\\/\",\"d\":[]}";
+  info("%s", json.Stringify());
+  assert(!strcmp(json.Stringify(), Expected), return false);
+
+  const char* Pretty =
+    "{\n"
+    "  \"a\": [\n"
+    "    1,\n"
+    "    2.5,\n"
+    "    {}\n"
+    "  ],\n"
+    "  \"b\\\"c\": \"x\\u0001\\/\",\n"
+    "  \"d\": []\n"
+    "}";
+  info("%s", json.Stringify(2));
+  assert(!strcmp(json.Stringify(2), Pretty), return false);
+
+  // Caller-supplied buffer: truncated, but the full length is reported
+  char Buffer[16];
+  size_t Length = json.Stringify(Buffer, sizeof(Buffer));
+  assert(Length == strlen(Expected), return false);
+  assert(!strncmp(Buffer, Expected, sizeof(Buffer)-1) && !Buffer[sizeof(Buffer)-1], return false);
+  assert(json.Stringify(Buffer, 0) == Length, return false);
+
+  // File sink
+  JSON         Copy;
+  FILE_WRAPPER File;
+  assert(File.Open("testOutput/Writer.json", FILE_WRAPPER::faCreate), return false);
+  assert(json.Stringify(&File, 4), return false);
+  File.Close();
+  assert(Copy.ParseFile("testOutput/Writer.json"), return false);
+  assert(!strcmp(Copy.Stringify(), Expected), return false);
+
+  // The reader can drive the writer directly, e.g. to convert JSON-5
+  char* Source = (char*)File.ReadAll("Resources/JSON5.json");
+  assert(Source, return false);
+  JSON_READER Reader;
+  JSON_WRITER Writer;
+  assert(Reader.Parse(&Writer, Source), return false);
+  assert(json.Parse(Source), return false);
+  delete[] Source;
+  assert(Copy.Parse(Writer.GetBuffer()), return false);
+  assert(!strcmp(Copy.Stringify(), json.Stringify()), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestUnion(){
+  Start("Tagged-union nodes");
+
+  info("sizeof(JSON) = %d", (int)sizeof(JSON));
+
+  // Every change of type destroys the old member and constructs the new one
+  JSON json;
+  json = "A string that is too long for the local buffer";
+  assert(json.Type == JSON::typeString, return false);
+  assert(!json["x"] && !json[0], return false);
+
+  JSON Five(5);
+  json.Append(Five);
+  assert(json.Type == JSON::typeArray && json.Items.size() == 2, return false);
+  assert(json[0]->Type == JSON::typeString && json[1]->Number == 5, return false);
+
+  json.AddOrUpdate("x", "y");
+  assert(json.Type == JSON::typeObject && json.Objects.size() == 1, return false);
+  assert(!json[0] && !strcmp(json["x"]->String.c_str(), "y"), return false);
+
+  json = true;
+  assert(json.Type == JSON::typeTrue, return false);
+
+  // Arena documents survive being re-parsed into a different type
+  assert(json.Parse("[{\"a\":\"b\"},\"c\"]", 0, JSON::pfArena), return false);
+  assert(json.Parse("{\"d\":[1,2,3]}", 0, JSON::pfArena), return false);
+  assert(json["d"] && json["d"]->Items.size() == 3, return false);
+  assert(json.Parse("\"e\"", 0, JSON::pfArena), return false);
+  assert(!strcmp(json.String.c_str(), "e"), return false);
+  assert(!strcmp(json.Stringify(), "\"e\""), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestMember(){
+  Start("Object members");
+
+  // Wide objects switch to the hash index, but keep their insertion order
+  JSON json;
+  char Name[16];
+  for(int n = 1000; n > 0; n--){
+    sprintf(Name, "k%d", n);
+    json.AddOrUpdate(Name, n);
+  }
+  assert(json.Objects.size() == 1000, return false);
+  for(int n = 1; n <= 1000; n++){
+    sprintf(Name, "k%d", n);
+    assert(json[Name] && json[Name]->Number == n, return false);
+  }
+  assert(!json["k0"] && !json["k1001"] && !json[""], return false);
+
+  int Expected = 1000;
+  for(auto Member = json.Objects.begin(); Member != json.Objects.end(); Member++){
+    sprintf(Name, "k%d", Expected);
+    assert(Member->first == Name && Member->second->Number == Expected, return false);
+    Expected--;
+  }
+
+  // Duplicates replace the value, but keep the position of the first
+  const char* Source = "{\"z\":1,\"a\":2,\"m\":3,\"a\":4}";
+  assert(json.Parse(Source), return false);
+  assert(!strcmp(json.Stringify(), "{\"z\":1,\"a\":4,\"m\":3}"), return false);
+
+  // Documents round-trip with their key order intact
+  Source = "{\"b\":{\"y\":[1,{\"q\":0,\"p\":1}],\"x\":null},\"a\":\"\",\"\":true}";
+  assert(json.Parse(Source, 0, JSON::pfArena), return false);
+  assert(!strcmp(json.Stringify(), Source), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestMove(){
+  Start("Move semantics");
+
+  // Heap subtrees are taken over without copying
+  JSON Part;
+  Part.AddOrUpdate("text", "A string that is too long for the local buffer");
+  Part.AddOrUpdate("list")->Append(1);
+  const char* Text = (*Part["text"]).String.c_str();
+  JSON*       List = Part["list"];
+
+  JSON json;
+  JSON* Member = json.AddOrUpdate("part", std::move(Part));
+  assert(Part.Type == JSON::typeNull, return false);
+  assert((*Member)["text"]->String.c_str() == Text && (*Member)["list"] == List, return false);
+
+  json.Append(std::move(*Member));
+  assert(json.Type == JSON::typeArray && json.Items.size() == 2, return false);
+  assert(json[0]->Type == JSON::typeObject && !(*json[0])["part"]->Objects.size(), return false);
+  assert((*json[1])["list"] == List, return false);
+
+  JSON Moved(std::move(json));
+  assert(json.Type == JSON::typeNull && (*Moved[1])["list"] == List, return false);
+
+  // A recursive update moves the members one by one
+  JSON Update;
+  assert(Update.Parse("{\"list\":[2],\"new\":true}"), return false);
+  Moved[1]->AddOrUpdate(std::move(Update));
+  assert(!strcmp(Moved[1]->Stringify(),
+    "{\"text\":\"A string that is too long for the local buffer\",\"list\":[2],\"new\":true}"
+  ), return false);
+
+  // The root of an arena document hands over its arena
+  const char* Source = "{\"a\":[1,2,3],\"b\":\"A string that is too long for the local buffer\"}";
+  JSON* Arena = new JSON;
+  assert(Arena->Parse(Source, 0, JSON::pfArena), return false);
+  Text = (*Arena)["b"]->String.c_str();
+
+  // ...but nodes inside it are copied, because they cannot outlive it
+  JSON Copy(std::move(*(*Arena)["a"]));
+  assert(Copy.Items.size() == 3 && (*Arena)["a"]->Items.size() == 3, return false);
+
+  JSON Owner(std::move(*Arena));
+  delete Arena;
+  assert(Owner["b"]->String.c_str() == Text, return false);
+  assert(!strcmp(Owner.Stringify(), Source), return false);
+
+  // Moving between different allocators copies
+  json = std::move(Owner);
+  assert(!strcmp(json.Stringify(), Source) && !strcmp(Owner.Stringify(), Source), return false);
+
+  // A node can take over, or copy, one of its own descendants
+  const char* Envelope = "{\"data\":{\"list\":[1,{\"x\":\"A string that is too long for the local buffer\"}]}}";
+  for(int Arena = 0; Arena < 2; Arena++){
+    assert(json.Parse(Envelope, 0, Arena ? JSON::pfArena : 0), return false);
+    json = std::move(*json["data"]);
+    assert(!strcmp(json.Stringify(), "{\"list\":[1,{\"x\":\"A string that is too long for the local buffer\"}]}"), return false);
+    json = *(*json["list"])[1];
+    assert(!strcmp(json.Stringify(), "{\"x\":\"A string that is too long for the local buffer\"}"), return false);
+    json = json;
+    assert(!strcmp(json["x"]->String.c_str(), "A string that is too long for the local buffer"), return false);
+  }
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestPath(){
+  Start("JSON Pointer");
+
+  const char* Source =
+    "{\"a\":{\"b\":[10,{\"c\":\"x\"},30,{\"c\":\"y\"}]},"
+    "\"a/b\":1,\"m~n\":2,\"\":3,\"01\":4,"
+    "\"arr\":[[1,2],[3,4]]}";
+
+  JSON json;
+  assert(json.Parse(Source), return false);
+
+  JSON_POINTER Pointer;
+  assert(Pointer.Compile("/a/b/1/c"), return false);
+  assert(Pointer.Find(&json) == (*(*json["a"])["b"])[1]->operator[]("c"), return false);
+
+  struct{ const char* Pointer; const char* Expected; } Tests[] = {
+    {""        , 0  }, // The whole document
+    {"/a~1b"   , "1"},
+    {"/m~0n"   , "2"},
+    {"/"       , "3"},
+    {"/01"     , "4"},
+    {"/a/b/0"  , "10"},
+    {"/a/b/01" , 0  },
+    {"/a/b/4"  , 0  },
+    {"/a/b/-"  , 0  },
+    {"/a/x"    , 0  },
+    {"/a/b/2/c", 0  }
+  };
+  for(size_t n = 0; n < sizeof(Tests)/sizeof(*Tests); n++){
+    assert(Pointer.Compile(Tests[n].Pointer), return false);
+    JSON* Result = Pointer.Find(&json);
+    if(!*Tests[n].Pointer){
+      assert(Result == &json, return false);
+    }else if(Tests[n].Expected){
+      assert(Result && !strcmp(Result->Stringify(), Tests[n].Expected), return false);
+    }else{
+      assert(!Result, return false);
+    }
+  }
+  assert(!Pointer.Compile("a"  ), return false);
+  assert(!Pointer.Compile("/~2"), return false);
+  assert(!Pointer.Compile("/a~"), return false);
+
+  // Wildcards and slices
+  std::vector<JSON*> Results;
+  assert(Pointer.Compile("/a/b/*/c"), return false);
+  assert(Pointer.FindAll(&json, &Results) == 2, return false);
+  assert(Results[0]->String == "x" && Results[1]->String == "y", return false);
+
+  Results.clear();
+  assert(Pointer.Compile("/a/b/1:3"), return false);
+  assert(Pointer.FindAll(&json, &Results) == 2 && Results[1]->Number == 30, return false);
+
+  assert(Pointer.Compile("/arr/*/1"), return false);
+  assert(Pointer.Find(&json)->Number == 2, return false);
+  assert(Pointer.Compile("/*/b/:1"), return false);
+  assert(Pointer.Find(&json)->Number == 10, return false);
+  assert(Pointer.Compile("/*", false) && !Pointer.Find(&json), return false);
+
+  // Streaming extraction, without building the document
+  JSON Result;
+  struct{ const char* Pointer; const char* Expected; } Streams[] = {
+    {"/a/b/1"  , "[{\"c\":\"x\"}]"},
+    {"/a/b/*/c", "[\"x\",\"y\"]"  },
+    {"/arr/*/0", "[1,3]"          },
+    {"/a/b/1:" , "[{\"c\":\"x\"},30,{\"c\":\"y\"}]"},
+    {"/a/x"    , "[]"             },
+    {"/"       , "[3]"            }
+  };
+  for(size_t n = 0; n < sizeof(Streams)/sizeof(*Streams); n++){
+    assert(Pointer.Compile(Streams[n].Pointer), return false);
+    assert(Pointer.Extract(&Result, Source), return false);
+    assert(!strcmp(Result.Stringify(), Streams[n].Expected), return false);
+  }
+  assert(Pointer.Compile(""), return false);
+  assert(Pointer.Extract(&Result, Source), return false);
+  assert(Result.Items.size() == 1 && !strcmp(Result[0]->Stringify(), json.Stringify()), return false);
+
+  // Without wildcards, the rest of the input is not even read
+  assert(Pointer.Compile("/first"), return false);
+  assert(Pointer.Extract(&Result, "{\"first\":{\"x\":1},\"rest\":...garbage"), return false);
+  assert(!strcmp(Result.Stringify(), "[{\"x\":1}]"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestLazy(){
+  Start("Lazy parsing");
+
+  const char* Source =
+    "{\"a\":{\"b\":[1,2,{\"c\":\"x\\\"]}\"}]},"
+    "\"s\":'}]', /* ]} */ \"n\":5, \"e\":[], // ]\n"
+    "\"bad\":[{\"x\": }]}";
+
+  JSON json;
+  assert(json.Parse(Source, 0, JSON::pfLazy), return false);
+
+  // Only the top level is parsed: nested values are not even validated
+  assert(json.Objects.size() == 5 && json["n"]->Number == 5, return false);
+  assert(!strcmp(json["s"]->String.c_str(), "}]"), return false);
+
+  JSON* a = json["a"];
+  assert(a->Type == JSON::typeObject && a->Objects.empty(), return false);
+  JSON* b = (*a)["b"];
+  assert(b && a->Objects.size() == 1 && b->Type == JSON::typeArray && b->Items.empty(), return false);
+  assert(b->Materialise() && b->Items.size() == 3, return false);
+  assert(!strcmp((*(*b)[2])["c"]->String.c_str(), "x\"]}"), return false);
+  assert(json["e"]->Materialise() && json["e"]->Items.empty(), return false);
+
+  // Each level is only parsed when it is needed
+  JSON* Bad = json["bad"];
+  assert(Bad->Materialise() && Bad->Items.size() == 1, return false);
+  info("Expect an error message:");
+  assert(!(*Bad)[0]->Materialise() && (*Bad)[0]->Type == JSON::typeNull, return false);
+
+  // Partly parsed documents produce the same output as fully parsed ones
+  char* Buffer = (char*)FILE_WRAPPER().ReadAll("Resources/JSON5.json");
+  assert(Buffer, return false);
+  JSON Eager, Copy;
+  assert(Eager.Parse(Buffer), return false);
+  for(int Flags = JSON::pfLazy; Flags <= (JSON::pfLazy | JSON::pfArena); Flags += JSON::pfArena){
+    assert(json.Parse(Buffer, 0, Flags), return false);
+    assert(!strcmp(json.Stringify(), Eager.Stringify()), return false);
+    assert(json["object"]->Objects.empty() && (*json["object"])["array"], return false);
+    assert(!strcmp(json.Stringify(2), Eager.Stringify(2)), return false);
+
+    // Copies and pointers parse whatever they need
+    Copy = json;
+    assert(!strcmp(Copy.Stringify(), Eager.Stringify()), return false);
+    assert(json.Parse(Buffer, 0, Flags), return false);
+    JSON_POINTER Pointer;
+    assert(Pointer.Compile("/object/array/2"), return false);
+    assert(!strcmp(Pointer.Find(&json)->String.c_str(), "three"), return false);
+  }
+  delete[] Buffer;
+
+  // Output fails, instead of being cut short, if a lazy value is invalid
+  std::string Text;
+  char        Small[0x40];
+  assert(json.Parse("{\"a\":{\"x\":1,,},\"b\":2}", 0, JSON::pfLazy), return false);
+  assert(!json.Stringify() && !json.Stringify(&Text) && Text.empty(), return false);
+  assert(!json.Stringify(Small, sizeof(Small)) && !Small[0], return false);
+  assert(json.Parse("{\"a\":[1,2,],\"b\":1}", 0, JSON::pfLazy | JSON::pfStrict), return false);
+  assert(!json.Stringify(2), return false);
+  json["a"]->Clear();
+  assert(!strcmp(json.Stringify(), "{\"a\":null,\"b\":1}"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+class LINES: public JSON_LINES::HANDLER{
+  public:
+    std::atomic<int>    Count;
+    std::atomic<double> Sum;
+    int                 Next;    // Expected "n" when ordered
+    bool                Ordered;
+    bool                InOrder;
+    int                 StopAt;  // Stop after this many records
+    std::vector<uint64_t> Errors;
+
+    LINES(bool Ordered, int StopAt = -1){
+      Count = 0; Sum = 0; Next = 0; InOrder = true;
+      this->Ordered = Ordered;
+      this->StopAt  = StopAt;
+    }
+    bool Record(uint64_t Offset, JSON* Record){
+      double n = (*Record)["n"]->Number;
+      if(Ordered && n != Next++) InOrder = false;
+      double Old = Sum;
+      while(!Sum.compare_exchange_weak(Old, Old + n));
+      return ++Count != StopAt;
+    }
+    bool Error(uint64_t Offset){
+      Errors.push_back(Offset); // Only called from one thread here
+      return true;
+    }
+};
+
+bool TestLines(){
+  Start("JSON Lines");
+
+  std::string Source;
+  int         Count = 20000;
+  double      Sum   = 0;
+  for(int n = 0; n < Count; n++){
+    char Line[0x100];
+    sprintf(Line, "{\"n\":%d,\"s\":\"Record number %d\",\"a\":[%d,{}]}%s\n", n, n, n, n % 3 ? "" : "\r");
+    Source += Line;
+    if(n % 1000 == 0) Source += "  \n";
+    Sum += n;
+  }
+
+  for(int Ordered = 0; Ordered < 2; Ordered++){
+    JSON_LINES Lines(4, 4000);
+    LINES      Handler(Ordered);
+    assert(Lines.Parse(&Handler, Source.data(), Source.size(), Ordered), return false);
+    assert(Handler.Count == Count && Handler.Sum == Sum && Handler.InOrder, return false);
+  }
+
+  // The handler can stop the parse
+  JSON_LINES Lines(4, 4000);
+  LINES      Stop(true, 100);
+  assert(!Lines.Parse(&Stop, Source.data(), Source.size()), return false);
+  assert(Stop.Count == 100 && Stop.InOrder, return false);
+
+  // Bad lines are reported by offset
+  std::string Bad = "{\"n\":0}\n{\"n\":\n{\"n\":1}";
+  LINES Errors(true);
+  info("Expect an error message:");
+  assert(!Lines.Parse(&Errors, Bad.data(), Bad.size()), return false);
+  assert(Errors.Count == 2 && Errors.Errors.size() == 1 && Errors.Errors[0] == 8, return false);
+
+  // Anything after the value on a line is an error
+  std::string Extra = "{\"n\":0} // Note\n{\"n\":1} {\"n\":2}\n{\"n\":1}x\n{\"n\":1}\t\r\n";
+  LINES Trailing(true);
+  assert(!Lines.Parse(&Trailing, Extra.data(), Extra.size()), return false);
+  assert(Trailing.Count == 2 && Trailing.Errors.size() == 2, return false);
+  assert(Trailing.Errors[0] == 16 && Trailing.Errors[1] == 32, return false);
+
+  // Records can be restricted to strict JSON
+  std::string Comma = "{\"n\":0}\n{\"n\":1,}\n";
+  LINES JSON5(true);
+  assert(Lines.Parse(&JSON5, Comma.data(), Comma.size()) && JSON5.Count == 2, return false);
+  LINES Strict(true);
+  Lines.SetFeatures(JSON_READER::Strict);
+  assert(!Lines.Parse(&Strict, Comma.data(), Comma.size()), return false);
+  assert(Strict.Count == 1 && Strict.Errors.size() == 1 && Strict.Errors[0] == 8, return false);
+
+  // Files are mapped
+  FILE_WRAPPER File;
+  assert(File.Open("testOutput/Lines.json", FILE_WRAPPER::faCreate), return false);
+  File.Write(Source.data(), Source.size());
+  File.Close();
+  LINES FromFile(true);
+  assert(JSON_LINES().ParseFile(&FromFile, "testOutput/Lines.json"), return false);
+  assert(FromFile.Count == Count && FromFile.InOrder, return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestBinary(){
+  Start("Testing CBOR and MessagePack");
+
+  const char* Source =
+    "{\"a\":1,\"b\":[2,3],\"Negative\":-1,\"Min\":-9223372036854775808,"
+    "\"Max\":18446744073709551615,\"Single\":1.5,\"Double\":0.1,"
+    "\"Text\":\"A string that is longer than thirty-one bytes\","
+    "\"Empty\":{},\"Flags\":[true,false,null],\"Wide\":[0,1,2,3,4,5,6,7,"
+    "8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25]}";
+  JSON json;
+  assert(json.Parse(Source), return false);
+
+  // Known encodings
+  JSON Small;
+  Small.Parse("{\"a\":1,\"b\":[2,3]}");
+  const uint8_t Cbor   [] = {0xA2, 0x61, 'a', 0x01, 0x61, 'b', 0x82, 0x02, 0x03};
+  const uint8_t MsgPack[] = {0x82, 0xA1, 'a', 0x01, 0xA1, 'b', 0x92, 0x02, 0x03};
+  CBOR_WRITER    CborWriter;
+  MSGPACK_WRITER MsgPackWriter;
+  assert(Small.Emit(&CborWriter   ), return false);
+  assert(Small.Emit(&MsgPackWriter), return false);
+  assert(CborWriter   .GetLength() == sizeof(Cbor   ), return false);
+  assert(MsgPackWriter.GetLength() == sizeof(MsgPack), return false);
+  assert(!memcmp(CborWriter   .GetBuffer(), Cbor   , sizeof(Cbor   )), return false);
+  assert(!memcmp(MsgPackWriter.GetBuffer(), MsgPack, sizeof(MsgPack)), return false);
+
+  // Round trips through the document
+  CBOR_READER    CborReader;
+  MSGPACK_READER MsgPackReader;
+  JSON           Result;
+  CborWriter.Clear();
+  assert(json.Emit(&CborWriter), return false);
+  assert(CborReader.Parse(&Result, CborWriter.GetBuffer(), CborWriter.GetLength()), return false);
+  assert(!strcmp(Result.Stringify(), Source), return false);
+  info("CBOR: %zu bytes, JSON: %zu bytes", CborWriter.GetLength(), strlen(Source));
+
+  MsgPackWriter.Clear();
+  assert(json.Emit(&MsgPackWriter), return false);
+  assert(MsgPackReader.Parse(&Result, MsgPackWriter.GetBuffer(), MsgPackWriter.GetLength(), JSON::pfArena), return false);
+  assert(!strcmp(Result.Stringify(), Source), return false);
+  info("MessagePack: %zu bytes", MsgPackWriter.GetLength());
+
+  // The text reader does not know the sizes: CBOR is written with
+  // indefinite lengths, and MessagePack headers are patched to the same
+  // bytes as from the document
+  JSON_READER    Reader;
+  CBOR_WRITER    Indefinite;
+  MSGPACK_WRITER Patched;
+  assert(Reader.Parse(&Indefinite, Source), return false);
+  assert(Reader.Parse(&Patched   , Source), return false);
+  assert(Indefinite.GetLength() > CborWriter.GetLength(), return false);
+  assert(CborReader.Parse(&Result, Indefinite.GetBuffer(), Indefinite.GetLength()), return false);
+  assert(!strcmp(Result.Stringify(), Source), return false);
+  assert(Patched.GetLength() == MsgPackWriter.GetLength(), return false);
+  assert(!memcmp(Patched.GetBuffer(), MsgPackWriter.GetBuffer(), Patched.GetLength()), return false);
+
+  // Converting between the binary encodings
+  MSGPACK_WRITER Converted;
+  assert(CborReader.Parse(&Converted, Indefinite.GetBuffer(), Indefinite.GetLength()), return false);
+  assert(Converted.GetLength() == MsgPackWriter.GetLength(), return false);
+  assert(!memcmp(Converted.GetBuffer(), MsgPackWriter.GetBuffer(), Converted.GetLength()), return false);
+
+  // Half floats, tags and indefinite-length strings
+  const uint8_t Other[] = {
+    0x83,                   // Array of 3
+    0xF9, 0x3E, 0x00,       // 1.5 (half)
+    0xC1, 0x1A, 0, 0, 0, 1, // Tag 1 (epoch time): 1
+    0x7F, 0x62, 'a', 'b', 0x61, 'c', 0xFF // "abc" in chunks
+  };
+  assert(CborReader.Parse(&Result, Other, sizeof(Other)), return false);
+  assert(!strcmp(Result.Stringify(), "[1.5,1,\"abc\"]"), return false);
+
+  // Errors
+  info("Expect an error message:");
+  assert(!CborReader.Parse(&Result, Cbor, sizeof(Cbor) - 1), return false);
+  const uint8_t Binary[] = {0x42, 0x01, 0x02};
+  assert(!CborReader.Parse(&Result, Binary, sizeof(Binary)), return false);
+  const uint8_t IntKey[] = {0x81, 0x01, 0x02};
+  assert(!MsgPackReader.Parse(&Result, IntKey, sizeof(IntKey)), return false);
+  assert(!MsgPackReader.Parse(&Result, MsgPack, sizeof(MsgPack) - 1), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+struct POINT{
+  int                 X, Y;
+  std::string         Name;
+  std::vector<double> Values;
+};
+
+JSON_BIND_TYPE(POINT){
+  JSON_BIND(X);
+  JSON_BIND(Y);
+  JSON_BIND_AS(Name, "name");
+  JSON_BIND(Values);
+}
+
+struct SHAPE{
+  bool                                   Closed;
+  uint8_t                                Colour;
+  int64_t                                Id;
+  float                                  Scale;
+  std::vector<POINT>                     Points;
+  std::map<std::string, std::string>     Tags;
+  std::vector<std::vector<unsigned>>     Grid;
+};
+
+JSON_BIND_TYPE(SHAPE){
+  JSON_BIND(Closed);
+  JSON_BIND(Colour);
+  JSON_BIND(Id);
+  JSON_BIND(Scale);
+  JSON_BIND(Points);
+  JSON_BIND(Tags);
+  JSON_BIND(Grid);
+}
+
+bool TestBind(){
+  Start("Testing typed binding");
+
+  const char* Source =
+    "{\"Closed\":true,\"Colour\":200,\"Id\":-9223372036854775808,"
+    "\"Scale\":0.5,\"Points\":[{\"X\":1,\"Y\":2,\"name\":\"A\","
+    "\"Values\":[1.5,2]},{\"X\":-3,\"Y\":4,\"name\":\"B\",\"Values\":[]}],"
+    "\"Tags\":{\"a\":\"x\",\"b\":\"y\"},\"Grid\":[[1,2],[3]]}";
+
+  SHAPE Shape;
+  Shape.Colour = 0;
+  assert(JSON_BINDING::Parse(&Shape, Source), return false);
+  assert(Shape.Closed && Shape.Colour == 200 && Shape.Id == INT64_MIN, return false);
+  assert(Shape.Scale == 0.5f && Shape.Points.size() == 2, return false);
+  assert(Shape.Points[0].X == 1 && Shape.Points[0].Name == "A", return false);
+  assert(Shape.Points[0].Values.size() == 2 && Shape.Points[0].Values[1] == 2, return false);
+  assert(Shape.Points[1].Y == 4 && Shape.Points[1].Values.empty(), return false);
+  assert(Shape.Tags.size() == 2 && Shape.Tags["b"] == "y", return false);
+  assert(Shape.Grid.size() == 2 && Shape.Grid[1][0] == 3, return false);
+
+  // Members are written in binding order, and maps in key order
+  std::string Result = JSON_BINDING::Stringify(Shape);
+  info("%s", Result.c_str());
+  assert(Result == Source, return false);
+
+  // Unknown keys are skipped, null leaves a member unchanged and integral
+  // values are accepted in any form
+  POINT Point;
+  Point.X = 7;
+  assert(JSON_BINDING::Parse(&Point,
+    "{Extra: {a: [1, {b: 2}], c: []}, X: null, Y: 3e1, name: 'C', Values: [0]}"
+  ), return false);
+  assert(Point.X == 7 && Point.Y == 30 && Point.Name == "C", return false);
+
+  // Null items of a vector<bool> are false, as in other vectors
+  std::vector<bool> Flags;
+  assert(JSON_BINDING::Parse(&Flags, "[true, null, false, true]"), return false);
+  assert(Flags.size() == 4 && Flags[0] && !Flags[1] && !Flags[2] && Flags[3], return false);
+  assert(JSON_BINDING::Stringify(Flags) == "[true,false,false,true]", return false);
+
+  // The decoder is a handler, so that other readers can drive it
+  CBOR_WRITER Cbor;
+  assert(JSON_BINDING::Emit(&Cbor, Shape), return false);
+  SHAPE        Copy;
+  JSON_DECODER Decoder(&Copy);
+  assert(CBOR_READER().Parse(&Decoder, Cbor.GetBuffer(), Cbor.GetLength()), return false);
+  assert(JSON_BINDING::Stringify(Copy) == Source, return false);
+
+  // Type mismatches and values that do not fit
+  info("Expect an error message:");
+  assert(!JSON_BINDING::Parse(&Point, "{\"X\": \"1\"}"), return false);
+  assert(!JSON_BINDING::Parse(&Point, "{\"X\": 1.5}"), return false);
+  assert(!JSON_BINDING::Parse(&Shape, "{\"Colour\": 256}"), return false);
+  assert(!JSON_BINDING::Parse(&Shape, "{\"Grid\": [[-1]]}"), return false);
+  assert(!JSON_BINDING::Parse(&Shape, "{\"Points\": {}}"), return false);
+  assert(!JSON_BINDING::Parse(&Flags, "[true, 1]"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestCache(){
+  Start("Incremental stringification");
+
+  // Compares the incremental output with a full serialisation
+  char Buffer[0x1000];
+  auto Same = [&Buffer](JSON& json, int Indent){
+    const char* Result = json.Stringify(Indent);
+    json.Stringify(Buffer, sizeof(Buffer), Indent);
+    if(strcmp(Result, Buffer)) info("%s\n%s", Result, Buffer);
+    return !strcmp(Result, Buffer);
+  };
+
+  JSON json;
+  assert(json.Parse(
+    "{\"a\":{\"b\":[1,2,{\"c\":\"x\"}],\"d\":{\"e\":true}},"
+    "\"f\":[[3],[4,5]],\"g\":null}"
+  ), return false);
+  assert(Same(json, 0), return false);
+
+  // An unchanged document returns the previous output as is
+  const char* Previous = json.Stringify();
+  assert(json.Stringify() == Previous, return false);
+
+  (*(*json["a"])["b"])[2]->AddOrUpdate("c", 12.5);
+  assert(Same(json, 0), return false);
+  json["a"]->AddOrUpdate("new", "member");
+  assert(Same(json, 0), return false);
+  *(*json["f"])[0] = "replaced";
+  assert(Same(json, 0), return false);
+  json["f"]->Append(6);
+  json["g"]->Append(7); // A scalar becomes an array
+  assert(Same(json, 0), return false);
+
+  // Moved subtrees take their new place in the output
+  json.AddOrUpdate("h", std::move(*(*json["a"])["d"]));
+  assert(Same(json, 0), return false);
+  (*json["h"])["e"]->operator=(false);
+  assert(Same(json, 0), return false);
+
+  // Changing the indentation serialises everything again
+  assert(Same(json, 2), return false);
+  (*json["f"])[1]->Append(8);
+  assert(Same(json, 2), return false);
+  assert(Same(json, 0), return false);
+
+  // Direct changes are only seen after Touch()
+  JSON* Member = (*json["a"])["new"];
+  Member->String = "edited";
+  assert(!strstr(json.Stringify(), "edited"), return false);
+  Member->Touch();
+  assert(strstr(json.Stringify(), "\"edited\"") && Same(json, 0), return false);
+
+  json["a"]->Clear();
+  assert(Same(json, 0), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestShared(){
+  Start("Concurrent read-only use");
+
+  JSON Config;
+  assert(Config.Parse(
+    "{\"name\":\"server\",\"ports\":[80,443],\"limits\":{\"rate\":2.5}}"
+  ), return false);
+  const JSON& Shared = Config;
+
+  std::string Expected, Compact;
+  Shared.Stringify(&Expected, 2);
+  Shared.Stringify(&Compact);
+
+  std::atomic<int> Failures(0);
+  std::vector<std::thread> Threads;
+  for(int t = 0; t < 4; t++){
+    Threads.emplace_back([&Shared, &Expected, &Compact, &Failures](){
+      char Buffer[0x100];
+      std::string Result;
+      for(int n = 0; n < 1000; n++){
+        Shared.Stringify(&Result, 2);
+        Shared.Stringify(Buffer, sizeof(Buffer));
+        const JSON* Port = (*Shared["ports"])[1];
+        if(
+          Result != Expected || Compact != Buffer ||
+          !Port || Port->GetInt64() != 443 ||
+          (*Shared["limits"])["rate"]->Number != 2.5
+        ) Failures++;
+      }
+    });
+  }
+  for(auto& Thread: Threads) Thread.join();
+  assert(!Failures, return false);
+
+  // Lazy containers are not parsed by const look-ups
+  JSON Lazy;
+  assert(Lazy.Parse("{\"a\":{\"b\":1}}", 0, JSON::pfLazy), return false);
+  const JSON& Const = Lazy;
+  assert(Const["a"] && !(*Const["a"])["b"], return false);
+  assert(Lazy["a"]->Materialise() && (*Const["a"])["b"]->GetInt64() == 1, return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestUTF8(){
+  Start("UTF-8 validation and surrogate pairs");
+
+  // Multi-byte sequences inside and after a vector block, with and without
+  // escape sequences
+  const char* Text = "ASCII text that is long enough: \xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80 end";
+  std::string Source = std::string("[\"") + Text + "\",\"" + Text + "\\n\"]";
+  JSON json;
+  assert(json.Parse(Source.c_str()), return false);
+  assert(json[0]->String == Text, return false);
+  assert(json[1]->String == (std::string(Text) + "\n").c_str(), return false);
+  assert(json.Parse(Source.c_str(), 0, JSON::pfInSitu) && json[0]->String == Text, return false);
+
+  // Pairs are combined, and unpaired surrogates replaced
+  assert(json.Parse("[\"\\uD83D\\uDE00\",\"\\uD83D\",\"\\uDE00x\",\"\\uD83D\\u0041\"]"), return false);
+  assert(json[0]->String == "\xF0\x9F\x98\x80", return false);
+  assert(json[1]->String == "\xEF\xBF\xBD", return false);
+  assert(json[2]->String == "\xEF\xBF\xBDx", return false);
+  assert(json[3]->String == "\xEF\xBF\xBD" "A", return false);
+
+  info("Expect an error message:");
+  const char* Invalid[] = {
+    "\"\xC0\x80\"",         // Overlong
+    "\"\xE0\x80\x80\"",     // Overlong
+    "\"\xED\xA0\x80\"",     // Surrogate
+    "\"\xF4\x90\x80\x80\"", // Beyond U+10FFFF
+    "\"\xF5\x80\x80\x80\"",
+    "\"\x80\"",             // Unexpected continuation
+    "\"\xE2\x82\"",         // Truncated
+    "\"\xE2\x82"            // Truncated at the end of the input
+  };
+  for(size_t n = 0; n < sizeof(Invalid)/sizeof(*Invalid); n++){
+    assert(!json.Parse(Invalid[n]), return false);
+  }
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+static bool Stream(JSON_STREAM* Stream, const char* Source){
+  size_t Length = strlen(Source);
+  for(size_t n = 0; n < Length; n += 2){
+    if(!Stream->Parse(Source + n, Length - n < 2 ? Length - n : 2)) return false;
+  }
+  return Stream->End();
+}
+
+static bool Stream(JSON* Document, const char* Source, unsigned Flags){
+  JSON_STREAM Stream;
+  Stream.Begin(Document, Flags);
+  return ::Stream(&Stream, Source);
+}
+
+static bool Stream(JSON_HANDLER* Handler, const char* Source, unsigned Features){
+  JSON_STREAM Stream;
+  Stream.Begin(Handler, Features);
+  return ::Stream(&Stream, Source);
+}
+//------------------------------------------------------------------------------
+
+bool TestStrict(){
+  Start("Strict and custom dialects");
+
+  const char* Standard = "{\"a\":[1,-0.25,true,null],\"b\":\"x\\ny\"}";
+  JSON json;
+  assert(json.Parse(Standard, 0, JSON::pfStrict), return false);
+  assert(!strcmp(json.Stringify(), Standard), return false);
+
+  // Each of these only uses the JSON-5 feature in the comment
+  struct{ const char* Source; unsigned Feature; } Extensions[] = {
+    {"[1 // Comment\n]"          , JSON_READER::fComments   },
+    {"[1 /* Comment */]"         , JSON_READER::fComments   },
+    {"{a: 1}"                    , JSON_READER::fIdentifiers},
+    {"['a']"                     , JSON_READER::fQuotes     },
+    {"[\"\\'\"]"                 , JSON_READER::fQuotes     },
+    {"[\"a\\\nb\"]"              , JSON_READER::fQuotes     },
+    {"[Infinity]"                , JSON_READER::fNumbers    },
+    {"[NaN]"                     , JSON_READER::fNumbers    },
+    {"[0x1F]"                    , JSON_READER::fNumbers    },
+    {"[+1]"                      , JSON_READER::fNumbers    },
+    {"[.5]"                      , JSON_READER::fNumbers    },
+    {"[5.]"                      , JSON_READER::fNumbers    },
+    {"[1,]"                      , JSON_READER::fTrailing   },
+    {"{\"a\":1,}"                , JSON_READER::fTrailing   },
+    {"[1,\v2]"                   , JSON_READER::fSpace      },
+    {"[\"a\tb\"]"                , JSON_READER::fControls   },
+    {"[\"\x01\"]"                , JSON_READER::fControls   },
+    {"[\"0123456789ABCDEF\x1F\"]", JSON_READER::fControls   },
+    {"[1] x"                     , JSON_READER::fTail       },
+    {"[1]]"                      , JSON_READER::fTail       }
+  };
+
+  info("Expect an error message:");
+  JSON_HANDLER Handler;
+  JSON_READER  Reader;
+  for(size_t n = 0; n < sizeof(Extensions)/sizeof(*Extensions); n++){
+    const char* Source  = Extensions[n].Source;
+    unsigned    Feature = Extensions[n].Feature;
+
+    Reader.SetFeatures(JSON_READER::JSON5);
+    assert(Reader.Parse(&Handler, Source), return false);
+    Reader.SetFeatures(JSON_READER::Strict);
+    assert(!Reader.Parse(&Handler, Source), return false);
+
+    // Custom dialects are checked at run time
+    Reader.SetFeatures(Feature);
+    assert(Reader.Parse(&Handler, Source), return false);
+    Reader.SetFeatures(JSON_READER::JSON5 & ~Feature);
+    assert(!Reader.Parse(&Handler, Source), return false);
+
+    // The push parser, fed two bytes at a time, accepts the same dialects
+    assert( Stream(&json, Source, 0               ), return false);
+    assert(!Stream(&json, Source, JSON::pfStrict  ), return false);
+    assert( Stream(&Handler, Source, Feature                     ), return false);
+    assert(!Stream(&Handler, Source, JSON_READER::JSON5 & ~Feature), return false);
+  }
+  assert(!json.Parse("{a: 1}", 0, JSON::pfStrict), return false);
+  assert(json.Parse("{a: 1}") && json["a"]->GetInt64() == 1, return false);
+
+  // Neither dialect allows line breaks or a NUL in strings, or an exponent
+  // without digits, but white space may follow the value
+  assert(!Reader.Parse(&Handler, "[\"a\nb\"]"), return false);
+  Reader.SetFeatures(JSON_READER::Strict);
+  assert(!Reader.Parse(&Handler, "[\"a\0b\"]", 7), return false);
+  Reader.SetFeatures(JSON_READER::JSON5);
+  assert( Reader.Parse(&Handler, "[\"a\0b\"]", 7), return false);
+  assert(!json.Parse("[1e]" , 0, JSON::pfStrict), return false);
+  assert(!json.Parse("[1e+]", 0, JSON::pfStrict), return false);
+  assert(!json.Parse("[1e+]"), return false);
+  assert( json.Parse("[1] \r\n", 0, JSON::pfStrict), return false);
+  assert( Stream(&json, "[1] \r\n", JSON::pfStrict), return false);
+
+  // Nested values of a lazy document are parsed in the same dialect
+  assert(json.Parse("{\"a\":[1,2,]}", 0, JSON::pfLazy), return false);
+  assert(json["a"]->Materialise() && json["a"]->Items.size() == 2, return false);
+  assert(json.Parse("{\"a\":[1,2,]}", 0, JSON::pfLazy | JSON::pfStrict), return false);
+  assert(!json["a"]->Materialise(), return false);
+  assert(json.Parse("{\"a\":{\"b\":[1]}}", 0, JSON::pfLazy | JSON::pfStrict), return false);
+  assert((*json["a"])["b"]->Materialise() && !strcmp(json.Stringify(), "{\"a\":{\"b\":[1]}}"), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestIntern(){
+  Start("Key interning");
+
+  JSON_KEYS Keys;
+  const char* Key = Keys.Intern("A key long enough to be allocated", 33);
+  assert(Key && Keys.Intern("A key long enough to be allocated", 33) == Key, return false);
+  assert(!strcmp(Key, "A key long enough to be allocated") && Keys.Count() == 1, return false);
+
+  JSON::InternKeys(&Keys);
+  const char* Source =
+    "{\"short\":1,\"A key long enough to be allocated\":2,"
+    "\"another_long_key_name\":{\"another_long_key_name\":3}}";
+
+  // Documents parsed on different threads share the stored keys
+  JSON Documents[4];
+  std::vector<std::thread> Threads;
+  for(int t = 0; t < 4; t++){
+    Threads.emplace_back([&Documents, Source, t](){ Documents[t].Parse(Source); });
+  }
+  for(auto& Thread: Threads) Thread.join();
+  for(int t = 0; t < 4; t++){
+    auto Member = Documents[t].Objects.begin();
+    if(t) assert(Member->first.c_str() != Documents[0].Objects.begin()->first.c_str(), return false);
+    assert((Member + 1)->first.c_str() == Key, return false);
+    assert((*Documents[t]["another_long_key_name"])["another_long_key_name"]->GetInt64() == 3, return false);
+  }
+  assert(Keys.Count() == 2, return false);
+
+  // ...as do new members, but in-situ keys stay in the buffer
+  JSON json;
+  json.AddOrUpdate("A key long enough to be allocated", 5);
+  assert(json.Objects.begin()->first.c_str() == Key, return false);
+  assert(json.Parse(Source, 0, JSON::pfInSitu), return false);
+  assert((json.Objects.begin() + 1)->first.c_str() != Key, return false);
+  assert(!strcmp(Documents[0].Stringify(), Source), return false);
+  JSON::InternKeys(0);
+
+  // A full table copies the keys as usual
+  JSON_KEYS Small(1);
+  JSON::InternKeys(&Small);
+  assert(json.Parse(Source) && Small.Count() <= 2 && !strcmp(json.Stringify(), Source), return false);
+  JSON::InternKeys(0);
+  json.Clear(); // Before the table is released
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestPacked(){
+  Start("Packed numeric arrays");
+
+  const char* Source =
+    "{\"a\":[1,-2,9223372036854775807],\"b\":[0.5,2,-1e+300],\"c\":[1,\"x\",2.5],"
+    "\"d\":[[1,2],[3.5]],\"e\":[],\"f\":[0.5,9007199254740993],\"g\":[18446744073709551615]}";
+  JSON json;
+  assert(json.Parse(Source, 0, JSON::pfPacked), return false);
+  assert(!strcmp(json.Stringify(), Source), return false);
+
+  size_t         Count;
+  const int64_t* Integers = json["a"]->GetPackedInt64(&Count);
+  assert(Integers && Count == 3 && Integers[2] == INT64_MAX, return false);
+  assert(!json["a"]->GetPackedDouble(&Count), return false);
+  const double* Doubles = json["b"]->GetPackedDouble(&Count);
+  assert(Doubles && Count == 3 && Doubles[1] == 2 && Doubles[2] == -1e300, return false);
+
+  // Mixed arrays, arrays of arrays, empty arrays, integers that are not
+  // exact as doubles and unsigned integers are not packed
+  assert(!json["c"]->GetPackedInt64(&Count) && !json["c"]->GetPackedDouble(&Count), return false);
+  assert(json["c"]->Items.size() == 3 && json["c"]->Items[0]->IsInt64(), return false);
+  assert(json["d"]->Items.size() == 2 && (*json["d"])[1]->GetPackedDouble(&Count), return false);
+  assert(!json["e"]->GetPackedInt64(&Count) && json["e"]->Items.empty(), return false);
+  assert(json["f"]->Items.size() == 2 && json["f"]->Items[1]->IsInt64(), return false);
+  assert(json["g"]->Items.size() == 1 && json["g"]->Items[0]->IsUint64(), return false);
+
+  // Const look-ups do not unpack, but the others do
+  const JSON& Const = *json["b"];
+  assert(!Const[0], return false);
+  assert((*json["a"])[2]->GetInt64() == INT64_MAX && !json["a"]->GetPackedInt64(&Count), return false);
+  assert((*json["b"])[1]->Number == 2 && !(*json["b"])[1]->IsInt64(), return false);
+  json["b"]->Append(7);
+  assert(!strcmp(json.Stringify(),
+    "{\"a\":[1,-2,9223372036854775807],\"b\":[0.5,2,-1e+300,7],\"c\":[1,\"x\",2.5],"
+    "\"d\":[[1,2],[3.5]],\"e\":[],\"f\":[0.5,9007199254740993],\"g\":[18446744073709551615]}"
+  ), return false);
+
+  // Copies are unpacked, and lazy values are packed when they are parsed
+  JSON Copy(json);
+  assert(!strcmp(Copy.Stringify(), json.Stringify()), return false);
+  assert(json.Parse(Source, 0, JSON::pfPacked | JSON::pfLazy | JSON::pfArena), return false);
+  assert(!json["a"]->GetPackedInt64(&Count) && json["a"]->Materialise(), return false);
+  assert(json["a"]->GetPackedInt64(&Count) && Count == 3, return false);
+  assert((*json["d"])[0]->Materialise() && (*json["d"])[0]->GetPackedInt64(&Count), return false);
+  assert(!strcmp(json.Stringify(), Source), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestThread(){
+  Start("Parallel stringify");
+
+  // A large array under an object, with lazy, packed and nested items
+  std::string Source = "{\"name\":\"test\",\"list\":[";
+  for(int n = 0; n < 5000; n++){
+    if(n) Source += ",";
+    Source += "{\"id\":" + std::to_string(n) + ",\"values\":[1,2," + std::to_string(n) + "],\"tag\":\"x\"}";
+  }
+  Source += "],\"end\":[true,null]}";
+
+  const unsigned Flags[] = {0, JSON::pfLazy, JSON::pfPacked, JSON::pfArena | JSON::pfPacked};
+  for(size_t f = 0; f < sizeof(Flags)/sizeof(Flags[0]); f++){
+    JSON json;
+    assert(json.Parse(Source.c_str(), 0, Flags[f]), return false);
+    if(Flags[f] & JSON::pfLazy) json["list"]->Materialise();
+
+    for(int Indent = 0; Indent <= 2; Indent += 2){
+      std::string Sequential, Parallel;
+      json.Stringify(&Sequential, Indent);
+      json.Stringify(&Parallel  , Indent, 3);
+      assert(Sequential == Parallel, return false);
+      if(!Indent) assert(Parallel == Source, return false);
+    }
+  }
+
+  // A large root array, which is split directly
+  JSON Root;
+  for(int n = 0; n < 3000; n++){
+    if(n & 1) Root.Append("odd");
+    else      Root.Append(n);
+  }
+  std::string Sequential, Parallel;
+  Root.Stringify(&Sequential, 4);
+  Root.Stringify(&Parallel  , 4, 0);
+  assert(Sequential == Parallel, return false);
+
+  // A lazy item that cannot be parsed fails the whole output
+  Source.replace(Source.rfind("\"id\":4000"), 9, "\"id\":,,,,");
+  JSON Lazy;
+  assert(Lazy.Parse(Source.c_str(), 0, JSON::pfLazy) && Lazy["list"]->Materialise(), return false);
+  assert(!Lazy.Stringify(&Parallel, 0, 3) && Parallel.empty(), return false);
+
+  // Small documents are written on the calling thread
+  JSON Small;
+  assert(Small.Parse("{\"a\":[1,2,3]}"), return false);
+  Small.Stringify(&Parallel, 0, 4);
+  assert(Parallel == "{\"a\":[1,2,3]}", return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
+bool TestIndex(){
+  Start("Index of a large file");
+
+  // Records with brackets, commas and quotes inside strings and comments
+  std::string Source = "[\n";
+  for(int n = 0; n < 1000; n++){
+    Source += "  {\"id\":" + std::to_string(n) + ",\"text\":\"a],\\\"{b\",\"list\":[" + std::to_string(n) + "]},\n";
+    Source += "  /* ], */ \"s" + std::to_string(n) + "\", " + std::to_string(n) + ".5, true, null,\n";
+  }
+  Source += "]";
+
+  FILE_WRAPPER File;
+  assert(File.WriteAll("testOutput/Index.json", (const byte*)Source.c_str()), return false);
+  remove("testOutput/Index.json.idx");
+
+  JSON       json;
+  JSON_INDEX Index;
+  assert(Index.Open("testOutput/Index.json"), return false);
+  assert(Index.GetCount() == 5000, return false);
+  assert(Index.Get(5*123, &json), return false);
+  assert(!strcmp(json.Stringify(), "{\"id\":123,\"text\":\"a],\\\"{b\",\"list\":[123]}"), return false);
+  assert(Index.Get(5*999 + 1, &json) && !strcmp(json.Stringify(), "\"s999\""), return false);
+  assert(Index.Get(5*7   + 2, &json) && json.Number == 7.5, return false);
+  assert(Index.Get(4999, &json) && json.Type == JSON::typeNull, return false);
+  assert(!Index.Get(5000, &json) && !Index.GetKey(0), return false);
+
+  // The saved index is loaded instead of scanning the file again
+  JSON_INDEX Loaded;
+  assert(Loaded.Load("testOutput/Index.json", "testOutput/Index.json.idx"), return false);
+  assert(Loaded.GetCount() == Index.GetCount(), return false);
+  for(size_t n = 0; n < Index.GetCount(); n += 97){
+    size_t Length1, Length2;
+    const char* Text1 = Index .GetText(n, &Length1);
+    const char* Text2 = Loaded.GetText(n, &Length2);
+    assert(Length1 == Length2 && !memcmp(Text1, Text2, Length1), return false);
+  }
+
+  // An index of a file that has changed is rebuilt
+  Index .Close();
+  Loaded.Close();
+  Source = "{\"b\":[1,2,],'a':{\"x\":\"}\"},c:-3,\"d\\u0041\":\"\"}";
+  assert(File.WriteAll("testOutput/Index.json", (const byte*)Source.c_str()), return false);
+  assert(!Loaded.Load("testOutput/Index.json", "testOutput/Index.json.idx"), return false);
+  assert(Index.Open("testOutput/Index.json"), return false);
+  assert(Index.GetCount() == 4 && !strcmp(Index.GetKey(3), "dA"), return false);
+  assert(Index.Find("a") == 1 && Index.Find("dA") == 3 && Index.Find("e") == JSON_INDEX::NotFound, return false);
+  assert(Index.Get(Index.Find("a"), &json) && !strcmp(json["x"]->String.c_str(), "}"), return false);
+  assert(Index.Get(Index.Find("c"), &json) && json.GetInt64() == -3, return false);
+  assert(Loaded.Load("testOutput/Index.json", "testOutput/Index.json.idx"), return false);
+  assert(Loaded.Find("b") == 0 && Loaded.Get(0, &json) && !strcmp(json.Stringify(), "[1,2]"), return false);
+
+  // Handlers read the values in the dialect they ask for
+  JSON_HANDLER Handler;
+  assert(Index.Get(0, &Handler) && Index.Get(2, &Handler, JSON_READER::Strict), return false);
+  assert(!Index.Get(0, &Handler, JSON_READER::Strict), return false);
+
+  // So is one that keeps its size
+  Index .Close();
+  Loaded.Close();
+  Source.replace(Source.find("-3"), 2, "-4");
+  assert(File.WriteAll("testOutput/Index.json", (const byte*)Source.c_str()), return false);
+  assert(!Loaded.Load("testOutput/Index.json", "testOutput/Index.json.idx"), return false);
+  assert(Index.Open("testOutput/Index.json"), return false);
+  assert(Index.Get(Index.Find("c"), &json) && json.GetInt64() == -4, return false);
+  assert(Loaded.Load("testOutput/Index.json", "testOutput/Index.json.idx"), return false);
+
+  info("Expect an error message:");
+  assert(File.WriteAll("testOutput/Index.json", (const byte*)"\"text\""), return false);
+  assert(!Index.Build("testOutput/Index.json") && !Index.GetCount(), return false);
+
+  Done(); return true;
+}
+//------------------------------------------------------------------------------
+
 int main(){
   SetupTerminal();
 
   printf("\n\n");
-  if(!TestBuild()) goto main_Error;
-  if(!TestLoad ()) goto main_Error;
-  if(!TestJSON5()) goto main_Error;
+  if(!TestBuild ()) goto main_Error;
+  if(!TestLoad  ()) goto main_Error;
+  if(!TestJSON5 ()) goto main_Error;
+  if(!TestArena ()) goto main_Error;
+  if(!TestInSitu()) goto main_Error;
+  if(!TestEvents()) goto main_Error;
+  if(!TestStream()) goto main_Error;
+  if(!TestFile  ()) goto main_Error;
+  if(!TestScan  ()) goto main_Error;
+  if(!TestNumber()) goto main_Error;
+  if(!TestFormat()) goto main_Error;
+  if(!TestWriter()) goto main_Error;
+  if(!TestUnion ()) goto main_Error;
+  if(!TestMember()) goto main_Error;
+  if(!TestMove  ()) goto main_Error;
+  if(!TestPath  ()) goto main_Error;
+  if(!TestLazy  ()) goto main_Error;
+  if(!TestLines ()) goto main_Error;
+  if(!TestBinary()) goto main_Error;
+  if(!TestBind  ()) goto main_Error;
+  if(!TestCache ()) goto main_Error;
+  if(!TestShared()) goto main_Error;
+  if(!TestUTF8  ()) goto main_Error;
+  if(!TestStrict()) goto main_Error;
+  if(!TestIntern()) goto main_Error;
+  if(!TestPacked()) goto main_Error;
+  if(!TestThread()) goto main_Error;
+  if(!TestIndex ()) goto main_Error;
 
   info(ANSI_FG_GREEN "All OK"); Done();
   return 0;